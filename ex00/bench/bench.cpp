@@ -0,0 +1,417 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/20 11:03:27 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/20 11:03:27 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <malloc.h>
+#include "../inc/ansi.h"
+#include "../inc/Date.hpp"
+#include "../inc/RateIndex.hpp"
+#include "../inc/DenseRateTable.hpp"
+#include "../inc/DateCache.hpp"
+#include "../inc/CompressedIndex.hpp"
+
+#define QUERY_COUNT 4000000
+#define LARGE_ROWS (1u << 23)
+
+// ─────────────────────────────────────────────────────────────
+// 🧰 helpers
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Loads data.csv the way BitCoinExchange::loadDatabase used to, into a map.
+ */
+static void loadMap(const std::string& filename, std::map<std::string, float>& database)
+{
+	std::ifstream file(filename.c_str());
+	if (!file.is_open())
+		throw std::runtime_error("could not open database file.");
+
+	std::string line;
+	std::getline(file, line);
+	while (std::getline(file, line))
+	{
+		size_t pos = line.find(',');
+		if (pos == std::string::npos) continue;
+
+		std::istringstream iss(line.substr(pos + 1));
+		float rate;
+		iss >> rate;
+		if (iss.fail()) continue;
+		database[line.substr(0, pos)] = rate;
+	}
+}
+
+/**
+ * Builds a RateIndex holding the same rows as the map.
+ */
+static void buildIndex(const std::map<std::string, float>& database, RateIndex& index)
+{
+	std::map<std::string, float>::const_iterator it;
+	for (it = database.begin(); it != database.end(); ++it)
+	{
+		uint32_t day;
+		if (Date::parse(it->first, day))
+			index.insert(day, it->second);
+	}
+	index.freeze();
+}
+
+/**
+ * Generates valid query dates spread over (and slightly around) the history.
+ */
+static void makeQueries(const RateIndex& index, std::vector<std::string>& dates, std::vector<uint32_t>& days)
+{
+	uint32_t first = index.dayAt(0) - 30;
+	uint32_t span = index.dayAt(index.size() - 1) - first + 60;
+
+	std::srand(42);
+	dates.reserve(QUERY_COUNT);
+	days.reserve(QUERY_COUNT);
+	for (size_t i = 0; i < QUERY_COUNT; i++)
+	{
+		uint32_t day = first + static_cast<uint32_t>(std::rand()) % span;
+		dates.push_back(Date::format(day));
+		days.push_back(day);
+	}
+}
+
+/**
+ * Generates query dates following a Zipf distribution over the days of the history: the k-th
+ * most frequent day (in a shuffled order) is drawn with a probability proportional to 1 / k^s.
+ */
+static void makeZipfQueries(const RateIndex& index, double s, std::vector<std::string>& dates)
+{
+	uint32_t first = index.dayAt(0);
+	size_t span = index.dayAt(index.size() - 1) - first + 1;
+
+	std::vector<uint32_t> days(span);
+	for (size_t i = 0; i < span; i++)
+		days[i] = first + static_cast<uint32_t>(i);
+	std::srand(7);
+	for (size_t i = span - 1; i > 0; i--)
+		std::swap(days[i], days[static_cast<size_t>(std::rand()) % (i + 1)]);
+
+	std::vector<double> cdf(span);
+	double total = 0;
+	for (size_t k = 0; k < span; k++)
+	{
+		total += 1.0 / std::pow(static_cast<double>(k + 1), s);
+		cdf[k] = total;
+	}
+
+	dates.clear();
+	dates.reserve(QUERY_COUNT);
+	for (size_t i = 0; i < QUERY_COUNT; i++)
+	{
+		double u = (static_cast<double>(std::rand()) + 0.5) / (static_cast<double>(RAND_MAX) + 1.0) * total;
+		size_t k = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+		dates.push_back(Date::format(days[std::min(k, span - 1)]));
+	}
+}
+
+/**
+ * @return The number of heap bytes currently allocated.
+ */
+static size_t heapInUse()
+{
+	return mallinfo2().uordblks;
+}
+
+/**
+ * Checks that a compressed index decodes back to every row of the index it was built from.
+ */
+static bool sameRows(const CompressedIndex& compressed, const RateIndex& index)
+{
+	CompressedIndex::Row rows[CompressedIndex::BLOCK_ROWS];
+	size_t pos = 0;
+	for (size_t b = 0; b < compressed.blocks(); b++)
+	{
+		size_t count = compressed.decodeBlock(b, rows);
+		for (size_t i = 0; i < count; i++, pos++)
+		{
+			if (pos >= index.size() || rows[i].day != index.dayAt(pos) || rows[i].rate != index.rateAt(pos)
+				|| rows[i].fixedRate != index.fixedRateAt(pos))
+				return false;
+		}
+	}
+	return pos == index.size();
+}
+
+/**
+ * Prints the memory held by one representation of the history.
+ */
+static void reportMemory(const char* label, size_t bytes, size_t rows)
+{
+	std::cout << BCYN << std::left << std::setw(32) << label << RESET
+			  << std::setw(10) << bytes << " bytes"
+			  << HBLK "  (" << std::fixed << std::setprecision(2)
+			  << static_cast<double>(bytes) / static_cast<double>(rows) << " bytes/row)" RESET << std::endl;
+}
+
+/**
+ * Prints one benchmark line in nanoseconds per query.
+ */
+static void report(const char* label, clock_t start, clock_t end, double checksum)
+{
+	double ns = static_cast<double>(end - start) / CLOCKS_PER_SEC * 1e9 / QUERY_COUNT;
+	std::cout << BCYN << std::left << std::setw(32) << label << RESET
+			  << std::fixed << std::setprecision(2) << std::setw(8) << ns << " ns/query"
+			  << HBLK "  (checksum " << checksum << ")" RESET << std::endl;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 📊 benchmarks
+// ─────────────────────────────────────────────────────────────
+
+static double benchMap(const std::map<std::string, float>& database, const std::vector<std::string>& dates)
+{
+	double sum = 0;
+	for (size_t i = 0; i < dates.size(); i++)
+	{
+		std::map<std::string, float>::const_iterator it = database.lower_bound(dates[i]);
+		if (it != database.end() && it->first == dates[i])
+			sum += it->second;
+		else if (it != database.begin())
+			sum += (--it)->second;
+	}
+	return sum;
+}
+
+static double benchIndexText(const RateIndex& index, const std::vector<std::string>& dates)
+{
+	double sum = 0;
+	for (size_t i = 0; i < dates.size(); i++)
+	{
+		uint32_t day;
+		if (!Date::parse(dates[i], day)) continue;
+		size_t pos = index.floor(day);
+		if (pos != RateIndex::npos)
+			sum += index.rateAt(pos);
+	}
+	return sum;
+}
+
+static double benchIndexDays(const RateIndex& index, const std::vector<uint32_t>& days)
+{
+	double sum = 0;
+	for (size_t i = 0; i < days.size(); i++)
+	{
+		size_t pos = index.floor(days[i]);
+		if (pos != RateIndex::npos)
+			sum += index.rateAt(pos);
+	}
+	return sum;
+}
+
+static double benchIndexBatch(const RateIndex& index, const std::vector<uint32_t>& days)
+{
+	const size_t block = 256;
+	size_t positions[block];
+	double sum = 0;
+	for (size_t start = 0; start < days.size(); start += block)
+	{
+		size_t count = std::min(block, days.size() - start);
+		index.floorBatch(&days[start], count, positions);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (positions[i] != RateIndex::npos)
+				sum += index.rateAt(positions[i]);
+		}
+	}
+	return sum;
+}
+
+static double benchIndexCached(const RateIndex& index, const std::vector<std::string>& dates, DateCache& cache)
+{
+	double sum = 0;
+	for (size_t i = 0; i < dates.size(); i++)
+	{
+		DateCache::Entry* entry = cache.lookup(dates[i].data(), dates[i].size());
+		if (entry && entry->state != DateCache::EMPTY)
+		{
+			if (entry->state == DateCache::FOUND)
+				sum += entry->rate;
+			continue;
+		}
+		uint32_t day = 0;
+		size_t pos = RateIndex::npos;
+		if (Date::parse(dates[i], day))
+			pos = index.floor(day);
+		if (pos != RateIndex::npos)
+			sum += index.rateAt(pos);
+		if (entry)
+		{
+			entry->state = (pos != RateIndex::npos) ? DateCache::FOUND : DateCache::NO_RATE;
+			entry->day = day;
+			entry->rate = (pos != RateIndex::npos) ? index.rateAt(pos) : 0.0f;
+		}
+	}
+	return sum;
+}
+
+static double benchCompressed(const CompressedIndex& compressed, const std::vector<uint32_t>& days)
+{
+	double sum = 0;
+	for (size_t i = 0; i < days.size(); i++)
+	{
+		CompressedIndex::Row row;
+		if (compressed.floor(days[i], row))
+			sum += row.rate;
+	}
+	return sum;
+}
+
+static double benchDense(const DenseRateTable& table, const std::vector<uint32_t>& days)
+{
+	double sum = 0;
+	for (size_t i = 0; i < days.size(); i++)
+	{
+		float rate;
+		if (table.lookup(days[i], rate))
+			sum += rate;
+	}
+	return sum;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🚀 main()
+// ─────────────────────────────────────────────────────────────
+
+int main(int argc, char **argv)
+{
+	std::string filename = (argc > 1) ? argv[1] : "data.csv";
+	std::map<std::string, float> database;
+	RateIndex index;
+	std::vector<std::string> dates;
+	std::vector<uint32_t> days;
+
+	size_t mapBytes = 0;
+	try {
+		size_t heap = heapInUse();
+		loadMap(filename, database);
+		mapBytes = heapInUse() - heap;
+		buildIndex(database, index);
+	} catch (const std::exception& e) {
+		std::cerr << BRED "❌ Error: " << e.what() << RESET << std::endl;
+		return 1;
+	}
+	if (index.empty())
+	{
+		std::cerr << BRED "❌ Error: empty database." RESET << std::endl;
+		return 1;
+	}
+	makeQueries(index, dates, days);
+
+	std::cout << BGRN "\n📊 " << index.size() << " rates, " << QUERY_COUNT << " queries\n" RESET << std::endl;
+
+	clock_t start = clock();
+	double sum = benchMap(database, dates);
+	report("std::map<std::string, float>", start, clock(), sum);
+
+	start = clock();
+	sum = benchIndexText(index, dates);
+	report("RateIndex (parse + search)", start, clock(), sum);
+
+	start = clock();
+	sum = benchIndexDays(index, days);
+	report("RateIndex (day numbers)", start, clock(), sum);
+
+	start = clock();
+	sum = benchIndexBatch(index, days);
+	report("RateIndex (batched, day numbers)", start, clock(), sum);
+
+	DenseRateTable dense;
+	if (dense.build(index))
+	{
+		start = clock();
+		sum = benchDense(dense, days);
+		report("DenseRateTable (day numbers)", start, clock(), sum);
+	}
+
+	CompressedIndex compressed;
+	compressed.build(index);
+	if (!sameRows(compressed, index))
+	{
+		std::cerr << BRED "❌ Error: the compressed index does not decode to the original rows." RESET << std::endl;
+		return 1;
+	}
+	start = clock();
+	sum = benchCompressed(compressed, days);
+	report("CompressedIndex (day numbers)", start, clock(), sum);
+
+	std::cout << BGRN "\n📊 Memory, " << index.size() << " rates\n" RESET << std::endl;
+	size_t flatBytes = index.size() * (sizeof(uint32_t) + sizeof(float) + sizeof(int64_t));
+	reportMemory("std::map<std::string, float>", mapBytes, index.size());
+	reportMemory("RateIndex", flatBytes, index.size());
+	reportMemory("CompressedIndex", compressed.memoryUsage(), index.size());
+	std::cout << HBLK "  " << std::setprecision(1)
+			  << static_cast<double>(mapBytes) / static_cast<double>(compressed.memoryUsage()) << "x smaller than the map, "
+			  << static_cast<double>(flatBytes) / static_cast<double>(compressed.memoryUsage()) << "x smaller than the index"
+			  RESET << std::endl;
+
+	// Skewed inputs, where most lines repeat a few dates
+	const double skews[] = { 0.0, 0.8, 1.1, 1.5 };
+	for (size_t i = 0; i < sizeof(skews) / sizeof(skews[0]); i++)
+	{
+		std::vector<std::string> zipf;
+		makeZipfQueries(index, skews[i], zipf);
+		std::cout << BGRN "\n📊 Zipf s=" << std::setprecision(1) << skews[i] << ", " << QUERY_COUNT << " queries\n" RESET << std::endl;
+
+		start = clock();
+		sum = benchIndexText(index, zipf);
+		report("RateIndex (parse + search)", start, clock(), sum);
+
+		DateCache cache;
+		start = clock();
+		sum = benchIndexCached(index, zipf, cache);
+		report("DateCache + RateIndex", start, clock(), sum);
+		std::cout << HBLK "  hit rate " << std::setprecision(1)
+				  << 100.0 * static_cast<double>(cache.hits()) / static_cast<double>(cache.hits() + cache.misses())
+				  << "%" RESET << std::endl;
+	}
+
+	// A history too large for the caches, where searches are bound by memory latency
+	RateIndex large;
+	large.reserve(LARGE_ROWS);
+	for (uint32_t i = 0; i < LARGE_ROWS; i++)
+		large.insert(index.dayAt(0) + 2 * i, static_cast<float>(i % 1000));
+	large.freeze();
+	for (size_t i = 0; i < days.size(); i++)
+		days[i] = large.dayAt(0) + static_cast<uint32_t>(std::rand()) % (2 * LARGE_ROWS);
+
+	std::cout << BGRN "\n📊 " << large.size() << " rates (synthetic), " << QUERY_COUNT << " queries\n" RESET << std::endl;
+
+	start = clock();
+	sum = benchIndexDays(large, days);
+	report("RateIndex (day numbers)", start, clock(), sum);
+
+	start = clock();
+	sum = benchIndexBatch(large, days);
+	report("RateIndex (batched, day numbers)", start, clock(), sum);
+
+	compressed.build(large);
+	start = clock();
+	sum = benchCompressed(compressed, days);
+	report("CompressedIndex (day numbers)", start, clock(), sum);
+
+	return 0;
+}
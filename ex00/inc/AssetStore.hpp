@@ -0,0 +1,63 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   AssetStore.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/10 15:42:19 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/10 15:42:19 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "RateIndex.hpp"
+
+/**
+ * Frozen rate histories of many assets in one contiguous store.
+ *
+ * The rows of every asset are laid out back to back in three shared arrays
+ * (day numbers, float rates and fixed-point rates), sorted by asset name then
+ * by date. An offset table gives the first row of each asset, so the history
+ * of an asset is a slice of the shared arrays, searched like a RateIndex.
+ * Asset names are packed into a single string with their own offset table and
+ * found with a binary search. Beyond its rows, an asset costs 12 bytes plus its
+ * name, so thousands of short series stay compact.
+ */
+class AssetStore
+{
+	public:
+		static const size_t npos;
+
+		AssetStore();
+		AssetStore(const AssetStore& other);
+		~AssetStore();
+		AssetStore& operator=(const AssetStore& other);
+
+		void build(const std::map<std::string, RateIndex>& series);
+		void clear();
+
+		bool empty() const;
+		size_t assets() const;
+		size_t size() const;
+		size_t find(const char* name, size_t len) const;
+		std::string name(size_t asset) const;
+		size_t floor(size_t asset, uint32_t day) const;
+		uint32_t dayAt(size_t pos) const;
+		float rateAt(size_t pos) const;
+		int64_t fixedRateAt(size_t pos) const;
+
+	private:
+		std::string _names;
+		std::vector<uint32_t> _nameOffsets;
+		std::vector<size_t> _offsets;
+		std::vector<uint32_t> _days;
+		std::vector<float> _rates;
+		std::vector<int64_t> _fixedRates;
+};
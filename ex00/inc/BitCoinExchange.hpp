@@ -12,8 +12,8 @@
 
 #pragma once
 
-#include <map>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -22,24 +22,145 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iomanip>
+#include <cstring>
+#include "RateIndex.hpp"
+#include "DenseRateTable.hpp"
+#include "RangeTable.hpp"
+#include "AssetStore.hpp"
+#include "CompressedIndex.hpp"
+#include "RcuPointer.hpp"
+#include "DateCache.hpp"
+#include "Date.hpp"
+#include "Decimal.hpp"
+#include "MappedFile.hpp"
+#include "OutputBuffer.hpp"
+#include "Snapshot.hpp"
+#include "ColumnFile.hpp"
+#include "Stats.hpp"
 
 class BitCoinExchange
 {
 	public:
+		struct Query
+		{
+			uint32_t day;
+			float amount;
+		};
+
+		struct Valuation
+		{
+			bool found;
+			float rate;
+			float value;
+		};
+
 		BitCoinExchange();
 		BitCoinExchange(const BitCoinExchange& other);
 		~BitCoinExchange();
 		BitCoinExchange& operator=(const BitCoinExchange& other);
 
 		void loadDatabase(const std::string& filename);
+		void loadCachedDatabase(const std::string& filename);
+		void loadAssets(const std::vector<std::string>& filenames);
+		void reloadDatabase(const std::string& filename);
+		size_t refreshDatabase(const std::string& filename);
+		void useDenseTable(bool enable);
+		void useRangeTable(bool enable);
+		void useExactArithmetic(bool enable);
+		void useColors(bool enable);
+		void useDateCache(bool enable);
+		void useCompressedHistory(bool enable);
+		bool summarizeRange(const std::string& from, const std::string& to, RangeTable::Summary& summary) const;
 		void processInputFile(const std::string& filename) const;
+		std::vector<Valuation> valueBatch(const std::vector<Query>& queries) const;
+		void streamInputFile(const std::string& filename, OutputBuffer& out, size_t threads = 1) const;
+		void valueRange(const char* begin, const char* end, OutputBuffer& out, DateCache* cache = NULL) const;
+		void processAssetFile(const std::string& filename, OutputBuffer& out) const;
+		void valueColumns(const int32_t* days, const double* amounts, size_t count, int32_t* status,
+			double* values) const;
+		size_t valueColumnFile(const std::string& input, const std::string& output) const;
+		size_t convertInputFile(const std::string& input, const std::string& output, size_t& skipped) const;
+		void appendError(OutputBuffer& out, const char* message, const char* text = NULL, size_t len = 0) const;
 
 	private:
-		std::map<std::string, float> _database;
+		static const size_t COLUMN_BLOCK = 1024;
+
+		enum ValueStatus
+		{
+			VALUE_OK,
+			VALUE_BAD_INPUT,
+			VALUE_NEGATIVE,
+			VALUE_TOO_LARGE
+		};
+
+		struct Tables
+		{
+			uint64_t version;
+			RateIndex index;
+			DenseRateTable dense;
+			RangeTable range;
+			AssetStore assets;
+			CompressedIndex compressed;
+
+			Tables() : version(0) {}
+		};
+
+		struct AssetRef
+		{
+			size_t id;
+			const char* name;
+			size_t len;
+		};
+
+		struct Feed
+		{
+			std::string filename;
+			uint64_t device;
+			uint64_t inode;
+			size_t offset;
+			size_t lastRow;
+			uint32_t lastDay;
+		};
+
+		RcuPointer<Tables> _tables;
+		bool _useDense;
+		bool _useRange;
+		bool _exact;
+		bool _colors;
+		bool _useCache;
+		bool _useCompressed;
+		Feed _feed;
+
+		bool isValidDate(const std::string& date, uint32_t& day) const;
+		bool isValidValue(const std::string& valueStr, float& value, OutputBuffer& out) const;
+		float getExchangeRate(uint32_t day, DateCache::Entry* entry = NULL) const;
+		int64_t getFixedExchangeRate(uint32_t day, DateCache::Entry* entry = NULL) const;
+		uint64_t tablesVersion() const;
+		static bool cachedDate(DateCache::Entry* entry, const char* date, size_t len, uint32_t& day);
+		static bool findRate(const Tables& tables, uint32_t day, float& rate);
+		static bool findFixedRate(const Tables& tables, uint32_t day, int64_t& rate);
+		static bool findAssetRate(const AssetStore& assets, size_t asset, uint32_t day, float& rate,
+			int64_t& fixedRate);
+		static size_t formatExact(const char* valueBegin, const char* valueEnd, int64_t rate, char* buffer);
+		static void countLookup(const Tables& tables, uint32_t day);
+		static Tables* copyTables(const RcuPointer<Tables>& tables);
+		static void restoreIndex(Tables& tables);
+		static const RateIndex& historyOf(const Tables& tables, RateIndex& scratch);
+		static void parseRows(const MappedFile& file, Feed& feed, RateIndex& index);
+		static void parseDatabase(const std::string& filename, Feed& feed, RateIndex& index);
+		static void startFeed(const std::string& filename, const MappedFile& file, Feed& feed);
+		static bool continuesFeed(const std::string& filename, const MappedFile& file, const Feed& feed);
+		static void seekFeedEnd(const MappedFile& file, Feed& feed);
+		static void parseAssetFile(const std::string& filename, std::map<std::string, RateIndex>& series);
+		void publish(Tables* next);
 
-		bool isValidDate(const std::string& date) const;
-		bool isLeapYear(int year) const;
-		bool isValidValue(const std::string& valueStr, float& value) const;
-		float getExchangeRate(const std::string& date) const;
+		ValueStatus checkValue(const char* begin, const char* end, float& value) const;
+		void valueLine(const char* begin, const char* end, OutputBuffer& out, const Tables& tables,
+			DateCache* cache = NULL, const AssetRef* asset = NULL) const;
+		void valueAssetLine(const char* begin, const char* end, OutputBuffer& out, const Tables& tables) const;
+		void appendResult(OutputBuffer& out, const char* date, size_t dateLen, const char* value,
+			size_t valueLen, const char* result, size_t resultLen, const AssetRef* asset = NULL) const;
+		void valueParallel(const char* begin, const char* end, OutputBuffer& out, size_t threads) const;
+		static void* valueChunks(void* arg);
 
 };
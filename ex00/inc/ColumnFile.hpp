@@ -0,0 +1,66 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ColumnFile.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/08 10:14:37 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/08 10:14:37 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include "MappedFile.hpp"
+
+/**
+ * Columnar binary batches of queries and results.
+ *
+ * Layout: a fixed 32-byte header, then `count` packed int32 values, padding up
+ * to the next multiple of 8 bytes, then `count` packed float64 values, all in
+ * native byte order. A query file holds the dates, as days since 1970-01-01
+ * (like an Arrow date32 column), and the amounts; a result file holds one
+ * status per query and the values, in the order of the queries.
+ */
+namespace ColumnFile
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	enum Kind
+	{
+		QUERIES = 1,
+		RESULTS = 2
+	};
+
+	enum Status
+	{
+		STATUS_OK,
+		STATUS_NO_RATE,
+		STATUS_NEGATIVE,
+		STATUS_TOO_LARGE,
+		STATUS_BAD_INPUT
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint32_t kind;
+		uint32_t reserved;
+		uint64_t count;
+	};
+
+	size_t valuesOffset(size_t count);
+	int32_t toEpochDay(uint32_t dayNumber);
+	bool fromEpochDay(int32_t epochDay, uint32_t& dayNumber);
+
+	bool write(const std::string& filename, Kind kind, const int32_t* keys, const double* values, size_t count);
+	bool map(const std::string& filename, Kind kind, MappedFile& file, const int32_t*& keys,
+		const double*& values, size_t& count);
+}
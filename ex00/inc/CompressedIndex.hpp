@@ -0,0 +1,98 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CompressedIndex.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/15 11:06:44 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/15 11:06:44 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "RateIndex.hpp"
+
+/**
+ * Compressed, read-only copy of a frozen rate index.
+ *
+ * Rows are cut into blocks of BLOCK_ROWS, and each block is written to a
+ * single bit stream as deltas against a base kept in the block index:
+ * - the days, as their distance to the first day of the block, bit-packed
+ *   with the width of the largest one;
+ * - the fixed-point rates, as their distance to the lowest rate of the block,
+ *   bit-packed the same way;
+ * - the float rates, each XORed with the previous one and written
+ *   Gorilla-style: a single 0 bit when it repeats, otherwise only the bits
+ *   between the leading and trailing zeros of the XOR. Blocks whose float
+ *   rates all equal the ones computed from their fixed-point rates, which is
+ *   the common case, skip this part and compute them instead.
+ *
+ * Each block records where it starts in the stream and its field widths, so
+ * blocks decode independently and any row of a block is read without decoding
+ * the previous ones. A lookup searches the first days of the blocks, then
+ * binary searches the packed days of one block and reads a single rate.
+ */
+class CompressedIndex
+{
+	public:
+		static const size_t BLOCK_ROWS = 64;
+
+		struct Row
+		{
+			uint32_t day;
+			float rate;
+			int64_t fixedRate;
+		};
+
+		CompressedIndex();
+		CompressedIndex(const CompressedIndex& other);
+		~CompressedIndex();
+		CompressedIndex& operator=(const CompressedIndex& other);
+
+		void build(const RateIndex& index);
+		void clear();
+		bool empty() const;
+		size_t size() const;
+		size_t blocks() const;
+		size_t memoryUsage() const;
+
+		bool floor(uint32_t day, Row& row) const;
+		size_t decodeBlock(size_t block, Row* rows) const;
+		void decompress(RateIndex& index) const;
+
+	private:
+		struct Block
+		{
+			int64_t fixedRate;
+			uint64_t bits;
+			float rate;
+			uint8_t dayWidth;
+			uint8_t rateWidth;
+			bool derived;
+		};
+
+		struct FloatState
+		{
+			uint32_t previous;
+			unsigned int leading;
+			unsigned int trailing;
+		};
+
+		std::vector<uint32_t> _firstDays;
+		std::vector<Block> _blocks;
+		std::vector<uint8_t> _bits;
+		size_t _bitCount;
+		size_t _count;
+
+		void writeBits(uint64_t value, unsigned int count);
+		void writeFloat(FloatState& state, float rate);
+		uint64_t readBits(size_t pos, unsigned int count) const;
+		float readFloat(FloatState& state, size_t& pos) const;
+		size_t rowsIn(size_t block) const;
+		static unsigned int widthOf(uint64_t value);
+};
@@ -0,0 +1,37 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Date.hpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/20 10:02:11 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/20 10:02:11 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Calendar helpers shared by the exchange-rate lookup structures.
+ *
+ * Dates are packed into a 32-bit day number so that comparing two dates is a
+ * single integer comparison. Day numbers are only meaningful relative to each
+ * other: they grow by one per calendar day and preserve chronological order.
+ */
+namespace Date
+{
+	bool isLeapYear(int year);
+	int daysInMonth(int year, int month);
+
+	uint32_t toDayNumber(int year, int month, int day);
+	void fromDayNumber(uint32_t dayNumber, int& year, int& month, int& day);
+
+	bool parse(const char* str, size_t len, uint32_t& dayNumber);
+	bool parse(const std::string& str, uint32_t& dayNumber);
+	std::string format(uint32_t dayNumber);
+}
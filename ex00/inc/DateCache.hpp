@@ -0,0 +1,112 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DateCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/12 09:37:52 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/12 09:37:52 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include "Stats.hpp"
+
+/**
+ * Direct-mapped memo of the dates seen in an input, keyed by their text.
+ *
+ * Input files repeat the same dates many times. Each slot remembers, for one
+ * "YYYY-MM-DD" text, whether the date is valid, its day number, and once it
+ * was looked up, the rate found for it. A repeated date then skips both the
+ * validation and the search. The 10 bytes of the text are the key, packed
+ * into two integers, so a probe is one hash and two compares; a colliding
+ * date simply evicts the previous one.
+ *
+ * The rates are only valid for the tables they were read from: bind() is
+ * called with the version of the pinned tables and empties the cache when it
+ * changes. A cache is not shared between threads.
+ */
+class DateCache
+{
+	public:
+		static const size_t SLOTS = 1024;
+		static const size_t KEY_LENGTH = 10;
+
+		enum State
+		{
+			EMPTY,
+			BAD_DATE,
+			VALID_DATE,
+			NO_RATE,
+			FOUND
+		};
+
+		struct Entry
+		{
+			uint64_t head;
+			uint16_t tail;
+			uint8_t state;
+			uint32_t day;
+			float rate;
+			int64_t fixedRate;
+		};
+
+		DateCache();
+		DateCache(const DateCache& other);
+		~DateCache();
+		DateCache& operator=(const DateCache& other);
+
+		void bind(uint64_t version);
+		void clear();
+		Entry* lookup(const char* date, size_t len);
+
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	private:
+		Entry _slots[SLOTS];
+		uint64_t _version;
+		uint64_t _hits;
+		uint64_t _misses;
+};
+
+/**
+ * Finds the slot of a date, claiming it if it holds another date.
+ *
+ * Defined inline because it runs once per input line.
+ *
+ * @param date The trimmed date text.
+ * @param len The length of the text.
+ * @return The slot, whose state is EMPTY on a miss, or NULL if the text is not
+ * 10 characters long and cannot be cached.
+ */
+inline DateCache::Entry* DateCache::lookup(const char* date, size_t len)
+{
+	if (len != KEY_LENGTH)
+		return NULL;
+
+	uint64_t head;
+	uint16_t tail;
+	std::memcpy(&head, date, sizeof(head));
+	std::memcpy(&tail, date + sizeof(head), sizeof(tail));
+	uint64_t hash = (head ^ (static_cast<uint64_t>(tail) << 48)) * 0x9E3779B97F4A7C15ULL;
+	Entry& entry = _slots[hash >> 54]; // 2^10 == SLOTS
+
+	if (entry.state != EMPTY && entry.head == head && entry.tail == tail)
+	{
+		++_hits;
+		BTC_STATS_COUNT(CACHE_HITS);
+		return &entry;
+	}
+	++_misses;
+	BTC_STATS_COUNT(CACHE_MISSES);
+	entry.head = head;
+	entry.tail = tail;
+	entry.state = EMPTY;
+	return &entry;
+}
@@ -0,0 +1,33 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Decimal.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 10:12:54 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/21 10:12:54 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Locale-free decimal number parsing working directly on character ranges.
+ *
+ * Besides floats, numbers can be read as fixed-point integers: the value times
+ * 10^scale, computed from the decimal digits themselves and therefore exact
+ * up to the chosen scale, or at the scale the number is written with.
+ */
+namespace Decimal
+{
+	const char* parseFloat(const char* begin, const char* end, float& value);
+	const char* parseFixed(const char* begin, const char* end, int scale, int64_t& value);
+	const char* parseExact(const char* begin, const char* end, int64_t& value, int& scale);
+	bool rescale(int64_t value, int shift, int64_t& result);
+	size_t formatFixed(int64_t value, int decimals, char* buffer);
+	size_t formatFloat(float value, int decimals, char* buffer);
+}
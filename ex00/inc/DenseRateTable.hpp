@@ -0,0 +1,64 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DenseRateTable.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/26 11:34:09 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/26 11:34:09 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include "RateIndex.hpp"
+
+/**
+ * Dense day-indexed rate table.
+ *
+ * Holds one slot per calendar day between the first and the last date of a
+ * rate index, each slot carrying forward the latest known rate. A lookup is a
+ * bounds check and an array access. Dates after the last slot use the last
+ * rate, dates before the first slot have no rate, exactly like a search in the
+ * index.
+ */
+class DenseRateTable
+{
+	public:
+		static const size_t MAX_DAYS = 1 << 22;
+
+		DenseRateTable();
+		DenseRateTable(const DenseRateTable& other);
+		~DenseRateTable();
+		DenseRateTable& operator=(const DenseRateTable& other);
+
+		bool build(const RateIndex& index);
+		void clear();
+		bool empty() const;
+		size_t size() const;
+
+		bool lookup(uint32_t day, float& rate) const;
+
+	private:
+		uint32_t _firstDay;
+		std::vector<float> _slots;
+};
+
+/**
+ * Defined inline because it replaces the search in the hottest path of btc.
+ */
+inline bool DenseRateTable::lookup(uint32_t day, float& rate) const
+{
+	if (day < _firstDay || _slots.empty())
+		return false;
+	uint32_t offset = day - _firstDay;
+	if (offset >= _slots.size())
+		offset = static_cast<uint32_t>(_slots.size() - 1);
+	rate = _slots[offset];
+	return true;
+}
@@ -0,0 +1,84 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ExchangeServer.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 15:47:22 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/28 15:47:22 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "BitCoinExchange.hpp"
+
+/**
+ * Long-running line protocol server on top of a loaded BitCoinExchange.
+ *
+ * Every request is a "date | value" line and gets exactly one response line,
+ * formatted like the output of btc. Requests are answered in order, and every
+ * complete line received in one read is answered in one batch, so clients can
+ * pipeline as many requests as they like.
+ *
+ * The server either listens on a Unix domain socket, multiplexing clients with
+ * an epoll event loop, or answers requests read from stdin on stdout. It runs
+ * until SIGINT or SIGTERM is received, or until stdin is closed.
+ *
+ * SIGHUP loads the rows appended to the database file in a background thread
+ * while requests keep being answered from the previous rates; the new rates
+ * are swapped in atomically once they are fully loaded.
+ */
+class ExchangeServer
+{
+	public:
+		static const size_t READ_SIZE = 1 << 16;
+		static const size_t MAX_LINE = 1 << 20;
+		static const size_t MAX_PENDING = 1 << 20;
+
+		ExchangeServer(BitCoinExchange& exchange, const std::string& database);
+		~ExchangeServer();
+
+		void serveSocket(const std::string& path);
+		void serveStdio();
+
+	private:
+		struct Connection
+		{
+			std::vector<char> input;
+			std::vector<char> output;
+			size_t sent;
+			bool closing;
+		};
+
+		BitCoinExchange& _exchange;
+		std::string _database;
+		pthread_t _reloader;
+		bool _reloaderStarted;
+		volatile int _reloading;
+		int _epoll;
+		int _listener;
+		std::string _path;
+		std::map<int, Connection> _connections;
+
+		ExchangeServer(const ExchangeServer& other);
+		ExchangeServer& operator=(const ExchangeServer& other);
+
+		size_t answer(std::vector<char>& input, bool final, std::vector<char>& output) const;
+		void rejectLine(std::vector<char>& output) const;
+		static bool skipLine(std::vector<char>& input);
+		void acceptClients();
+		void readClient(int fd);
+		void writeClient(int fd);
+		void closeClient(int fd);
+		void shutdown();
+
+		void startReload();
+		void joinReload();
+		static void* reload(void* arg);
+};
@@ -0,0 +1,49 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MappedFile.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 09:40:12 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/21 09:40:12 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * The mapping is released when the object is closed or destroyed. Copying is
+ * disabled because two objects must never unmap the same pages.
+ */
+class MappedFile
+{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const std::string& filename);
+		void close();
+
+		bool isOpen() const;
+		const char* data() const;
+		size_t size() const;
+		uint64_t device() const;
+		uint64_t inode() const;
+
+	private:
+		const char* _data;
+		size_t _size;
+		bool _open;
+		uint64_t _device;
+		uint64_t _inode;
+
+		MappedFile(const MappedFile& other);
+		MappedFile& operator=(const MappedFile& other);
+};
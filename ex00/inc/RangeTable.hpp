@@ -0,0 +1,68 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RangeTable.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/04 14:27:05 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/04 14:27:05 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "RateIndex.hpp"
+
+/**
+ * Aggregates of a rate index over date ranges.
+ *
+ * A range covers the rates in effect on its days: the rows dated inside the
+ * range plus the row carried forward into its first day. Days before the
+ * first row of the history have no rate and are not counted.
+ *
+ * Prefix sums of the rates and of the rate-days (each rate times the number
+ * of days it stays in effect) answer the mean and the time-weighted mean in
+ * O(1). Minimum and maximum come from a sparse table over blocks of BLOCK
+ * rows, plus a scan of the two partial blocks at the ends of the range, which
+ * keeps the table small (N / BLOCK * log N entries) with O(BLOCK) queries.
+ */
+class RangeTable
+{
+	public:
+		static const size_t BLOCK = 64;
+
+		struct Summary
+		{
+			uint32_t firstDay;
+			uint32_t lastDay;
+			size_t rates;
+			float min;
+			float max;
+			double mean;
+			double timeWeighted;
+		};
+
+		RangeTable();
+		RangeTable(const RangeTable& other);
+		~RangeTable();
+		RangeTable& operator=(const RangeTable& other);
+
+		void build(const RateIndex& index);
+		void clear();
+		bool empty() const;
+
+		bool query(const RateIndex& index, uint32_t from, uint32_t to, Summary& summary) const;
+
+	private:
+		std::vector<double> _sums;
+		std::vector<double> _areas;
+		std::vector<std::vector<float> > _min;
+		std::vector<std::vector<float> > _max;
+
+		void extremes(const RateIndex& index, size_t first, size_t last, float& min, float& max) const;
+		double area(const RateIndex& index, uint32_t day) const;
+};
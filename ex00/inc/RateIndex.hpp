@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RateIndex.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/20 10:15:40 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/20 10:15:40 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include "MappedFile.hpp"
+
+/**
+ * Frozen, contiguous exchange-rate index.
+ *
+ * Day numbers are kept in a sorted array and rates in a parallel array, so a
+ * lookup touches two flat arrays instead of chasing map nodes. Rows are first
+ * collected with insert() and then sorted and deduplicated by freeze(); when
+ * the same date appears more than once, the last inserted rate wins, exactly
+ * like repeated assignments into a std::map. A frozen index can be extended
+ * with merge(), which only rewrites the rows from the first newer date on.
+ *
+ * Every row also carries its rate as a fixed-point integer (the rate times
+ * FIXED_UNIT, that is 10^FIXED_SCALE), read from the CSV text, for exact valuations. A rate
+ * written with more than FIXED_SCALE decimals has no such integer and holds
+ * INEXACT_RATE instead, so that exact valuations can refuse it.
+ *
+ * An index can also adopt arrays living in a memory mapped snapshot. It then
+ * searches the mapping directly and only copies the rows into its own vectors
+ * if it is modified or copied.
+ */
+class RateIndex
+{
+	public:
+		static const size_t npos;
+		static const int64_t INEXACT_RATE;
+		static const int FIXED_SCALE = 4;
+		static const int64_t FIXED_UNIT;
+		static const size_t BATCH_LANES = 16;
+
+		RateIndex();
+		RateIndex(const RateIndex& other);
+		~RateIndex();
+		RateIndex& operator=(const RateIndex& other);
+
+		void clear();
+		void reserve(size_t count);
+		void insert(uint32_t day, float rate);
+		void insert(uint32_t day, float rate, int64_t fixedRate);
+		void freeze();
+		void merge(const RateIndex& newer);
+		void adopt(MappedFile* mapping, const uint32_t* days, const float* rates,
+			const int64_t* fixedRates, size_t count);
+		bool isMapped() const;
+
+		size_t size() const;
+		bool empty() const;
+		size_t floor(uint32_t day) const;
+		void floorSorted(const uint32_t* days, size_t count, size_t* positions) const;
+		void floorBatch(const uint32_t* days, size_t count, size_t* positions) const;
+		uint32_t dayAt(size_t pos) const;
+		float rateAt(size_t pos) const;
+		int64_t fixedRateAt(size_t pos) const;
+		const uint32_t* days() const;
+		const float* rates() const;
+		const int64_t* fixedRates() const;
+
+		static size_t floorSearch(const uint32_t* days, size_t count, uint32_t day);
+
+	private:
+		std::vector<uint32_t> _days;
+		std::vector<float> _rates;
+		std::vector<int64_t> _fixedRates;
+		MappedFile* _mapping;
+		const uint32_t* _dayData;
+		const float* _rateData;
+		const int64_t* _fixedData;
+		size_t _count;
+
+		void materialize();
+		void sync();
+};
@@ -0,0 +1,236 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RcuPointer.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/30 10:21:36 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/30 10:21:36 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * Owning pointer to an immutable object, replaced with read-copy-update.
+ *
+ * Readers enter a read-side section with a ReadGuard and may use the object
+ * until the guard is destroyed. They never take a lock: entering costs one
+ * atomic increment on a per-thread-stripe counter and leaving one decrement.
+ *
+ * Writers take the writer lock (WriteGuard), build a complete new object, and
+ * publish() it with an atomic pointer swap. Before the old object is deleted,
+ * the writer flips the reader generation and waits for every reader that may
+ * still hold the old pointer (the readers counted under the previous parity)
+ * to leave. Readers therefore always see either the old or the new object,
+ * never a half-built one, and are never paused by a reload.
+ */
+template <typename T>
+class RcuPointer
+{
+	public:
+		class ReadGuard
+		{
+			public:
+				explicit ReadGuard(const RcuPointer& pointer);
+				~ReadGuard();
+
+				const T& operator*() const;
+				const T* operator->() const;
+
+			private:
+				const RcuPointer& _pointer;
+				volatile uint64_t* _counter;
+				const T* _object;
+
+				ReadGuard(const ReadGuard& other);
+				ReadGuard& operator=(const ReadGuard& other);
+		};
+
+		class WriteGuard
+		{
+			public:
+				explicit WriteGuard(RcuPointer& pointer);
+				~WriteGuard();
+
+			private:
+				RcuPointer& _pointer;
+
+				WriteGuard(const WriteGuard& other);
+				WriteGuard& operator=(const WriteGuard& other);
+		};
+
+		explicit RcuPointer(T* object);
+		~RcuPointer();
+
+		const T& current() const;
+		void publish(T* next);
+
+	private:
+		static const size_t STRIPES = 16;
+
+		struct Counter
+		{
+			volatile uint64_t count;
+			char padding[64 - sizeof(uint64_t)];
+		};
+
+		T* volatile _object;
+		volatile uint64_t _generation;
+		mutable Counter _readers[2][STRIPES];
+		pthread_mutex_t _writeLock;
+
+		RcuPointer(const RcuPointer& other);
+		RcuPointer& operator=(const RcuPointer& other);
+
+		static size_t stripe();
+		void waitForReaders(uint64_t parity) const;
+};
+
+/**
+ * Constructor
+ *
+ * @param object The initial object, allocated with new. The pointer owns it.
+ */
+template <typename T>
+RcuPointer<T>::RcuPointer(T* object) : _object(object), _generation(0)
+{
+	for (size_t p = 0; p < 2; p++)
+		for (size_t i = 0; i < STRIPES; i++)
+			_readers[p][i].count = 0;
+	pthread_mutex_init(&_writeLock, NULL);
+}
+
+/**
+ * Destructor
+ *
+ * Deletes the current object. No reader may be active anymore.
+ */
+template <typename T>
+RcuPointer<T>::~RcuPointer()
+{
+	delete _object;
+	pthread_mutex_destroy(&_writeLock);
+}
+
+/**
+ * Returns the current object, for writers holding a WriteGuard.
+ */
+template <typename T>
+const T& RcuPointer<T>::current() const
+{
+	return *_object;
+}
+
+/**
+ * Publishes a new object and deletes the previous one once no reader can
+ * still be using it. The caller must hold a WriteGuard.
+ *
+ * @param next The new object, allocated with new. The pointer owns it.
+ */
+template <typename T>
+void RcuPointer<T>::publish(T* next)
+{
+	T* old = __atomic_exchange_n(&_object, next, __ATOMIC_SEQ_CST);
+	uint64_t generation = __atomic_load_n(&_generation, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&_generation, generation + 1, __ATOMIC_SEQ_CST);
+	waitForReaders(generation & 1);
+	delete old;
+}
+
+/**
+ * Spreads threads over the reader counters so that they do not all bounce
+ * the same cache line: each thread gets the next stripe on first use.
+ */
+template <typename T>
+size_t RcuPointer<T>::stripe()
+{
+	static volatile size_t next = 0;
+	static __thread size_t slot = 0;
+
+	if (slot == 0)
+		slot = __atomic_add_fetch(&next, 1, __ATOMIC_RELAXED);
+	return slot % STRIPES;
+}
+
+/**
+ * Waits until every reader counted under the given parity has left.
+ */
+template <typename T>
+void RcuPointer<T>::waitForReaders(uint64_t parity) const
+{
+	for (size_t i = 0; i < STRIPES; i++)
+	{
+		while (__atomic_load_n(&_readers[parity][i].count, __ATOMIC_SEQ_CST) != 0)
+			sched_yield();
+	}
+}
+
+/**
+ * Enters a read-side section and pins the current object.
+ *
+ * The reader registers under the parity of the current generation, then
+ * checks that the generation did not change meanwhile; if it did, it retries,
+ * so a writer waiting on a parity always sees every reader that may hold the
+ * object it is about to delete.
+ */
+template <typename T>
+RcuPointer<T>::ReadGuard::ReadGuard(const RcuPointer& pointer) : _pointer(pointer)
+{
+	size_t stripe = RcuPointer::stripe();
+	for (;;)
+	{
+		uint64_t generation = __atomic_load_n(&_pointer._generation, __ATOMIC_SEQ_CST);
+		_counter = &_pointer._readers[generation & 1][stripe].count;
+		__atomic_add_fetch(_counter, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&_pointer._generation, __ATOMIC_SEQ_CST) == generation)
+			break;
+		__atomic_sub_fetch(_counter, 1, __ATOMIC_RELEASE);
+	}
+	_object = __atomic_load_n(&_pointer._object, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Leaves the read-side section.
+ */
+template <typename T>
+RcuPointer<T>::ReadGuard::~ReadGuard()
+{
+	__atomic_sub_fetch(_counter, 1, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+const T& RcuPointer<T>::ReadGuard::operator*() const
+{
+	return *_object;
+}
+
+template <typename T>
+const T* RcuPointer<T>::ReadGuard::operator->() const
+{
+	return _object;
+}
+
+/**
+ * Takes the writer lock, serializing read-copy-update sequences.
+ */
+template <typename T>
+RcuPointer<T>::WriteGuard::WriteGuard(RcuPointer& pointer) : _pointer(pointer)
+{
+	pthread_mutex_lock(&_pointer._writeLock);
+}
+
+/**
+ * Releases the writer lock.
+ */
+template <typename T>
+RcuPointer<T>::WriteGuard::~WriteGuard()
+{
+	pthread_mutex_unlock(&_pointer._writeLock);
+}
@@ -0,0 +1,56 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Snapshot.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/24 16:05:48 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/24 16:05:48 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include "RateIndex.hpp"
+
+/**
+ * Binary snapshot of a frozen rate index.
+ *
+ * Layout: a fixed header, then `count` packed uint32 day numbers, `count`
+ * packed float rates and `count` packed int64 fixed-point rates, all in native
+ * byte order. The header is 48 bytes long and the first two arrays hold 8
+ * bytes per row together, so the int64 array stays 8-byte aligned. The header records the size
+ * and modification time, to the nanosecond, of the CSV file the snapshot was
+ * built from, so a snapshot whose source has changed is detected as stale and
+ * rebuilt, even when the file was rewritten within the same second.
+ */
+namespace Snapshot
+{
+	static const uint32_t VERSION = 4;
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	struct Source
+	{
+		uint64_t size;
+		int64_t mtime;
+		int64_t mtimeNsec;
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t count;
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		int64_t sourceMtimeNsec;
+	};
+
+	bool describe(const std::string& filename, Source& source);
+	bool write(const std::string& filename, const RateIndex& index, const Source& source);
+	bool map(const std::string& filename, const Source& source, RateIndex& index);
+}
@@ -0,0 +1,100 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Stats.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/02 09:12:48 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/02 09:12:48 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <ostream>
+#include <stdint.h>
+
+/**
+ * Optional per-stage timings and counters.
+ *
+ * Instrumentation is compiled in with `make STATS=1` (which defines BTC_STATS)
+ * and costs nothing otherwise: the BTC_STATS_* macros expand to no-ops and no
+ * clock is ever read.
+ *
+ * Each thread records into its own tables, so instrumented code never shares
+ * a cache line; the tables of finished threads are folded into a global total
+ * and dump() sums them with the tables of the calling thread. Latencies are
+ * kept in log-linear histograms (four sub-buckets per power of two, like an
+ * HDR histogram with two significant bits), from which percentiles are read.
+ */
+namespace Stats
+{
+	enum Stage
+	{
+		STAGE_LOAD,
+		STAGE_SPLIT,
+		STAGE_DATE,
+		STAGE_VALUE,
+		STAGE_LOOKUP,
+		STAGE_OUTPUT,
+		STAGE_COUNT
+	};
+
+	enum Counter
+	{
+		LINES_VALID,
+		LINES_BAD_INPUT,
+		LINES_NEGATIVE,
+		LINES_TOO_LARGE,
+		LINES_NO_RATE,
+		LOOKUP_EXACT,
+		LOOKUP_CARRIED,
+		CACHE_HITS,
+		CACHE_MISSES,
+		COUNTER_COUNT
+	};
+
+	static const unsigned int SUB_BITS = 2;
+	static const unsigned int BUCKETS = 64 << SUB_BITS;
+
+	uint64_t now();
+	unsigned int bucketOf(uint64_t ns);
+	uint64_t bucketFloor(unsigned int bucket);
+
+	void count(Counter counter);
+	void record(Stage stage, uint64_t ns);
+	void dump(std::ostream& out);
+
+	/**
+	 * Times a stage from its construction until stop() or its destruction.
+	 */
+	class Timer
+	{
+		public:
+			explicit Timer(Stage stage);
+			~Timer();
+
+			void stop();
+
+		private:
+			Stage _stage;
+			uint64_t _start;
+			bool _running;
+
+			Timer(const Timer& other);
+			Timer& operator=(const Timer& other);
+	};
+}
+
+#ifdef BTC_STATS
+# define BTC_STATS_COUNT(counter) Stats::count(Stats::counter)
+# define BTC_STATS_TIMER(name, stage) Stats::Timer name(Stats::stage)
+# define BTC_STATS_STOP(name) name.stop()
+# define BTC_STATS_ONLY(statement) statement
+#else
+# define BTC_STATS_COUNT(counter) ((void)0)
+# define BTC_STATS_TIMER(name, stage) ((void)0)
+# define BTC_STATS_STOP(name) ((void)0)
+# define BTC_STATS_ONLY(statement) ((void)0)
+#endif
@@ -0,0 +1,217 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   AssetStore.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/10 15:42:19 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/10 15:42:19 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/AssetStore.hpp"
+#include <algorithm>
+#include <cstring>
+
+const size_t AssetStore::npos = static_cast<size_t>(-1);
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty store.
+ */
+AssetStore::AssetStore() {}
+
+/**
+ * Copy constructor
+ *
+ * @param other The store to copy from.
+ */
+AssetStore::AssetStore(const AssetStore& other)
+	: _names(other._names), _nameOffsets(other._nameOffsets), _offsets(other._offsets),
+	_days(other._days), _rates(other._rates), _fixedRates(other._fixedRates) {}
+
+/**
+ * Destructor
+ */
+AssetStore::~AssetStore() {}
+
+/**
+ * Assignment operator
+ *
+ * @param other The store to assign from.
+ * @return A reference to this store.
+ */
+AssetStore& AssetStore::operator=(const AssetStore& other)
+{
+	if (this != &other)
+	{
+		_names = other._names;
+		_nameOffsets = other._nameOffsets;
+		_offsets = other._offsets;
+		_days = other._days;
+		_rates = other._rates;
+		_fixedRates = other._fixedRates;
+	}
+	return *this;
+}
+
+/**
+ * Replaces the content of the store with a set of histories.
+ *
+ * @param series The frozen history of each asset, by name.
+ */
+void AssetStore::build(const std::map<std::string, RateIndex>& series)
+{
+	clear();
+	size_t rows = 0;
+	size_t chars = 0;
+	std::map<std::string, RateIndex>::const_iterator it;
+	for (it = series.begin(); it != series.end(); ++it)
+	{
+		rows += it->second.size();
+		chars += it->first.size();
+	}
+
+	_names.reserve(chars);
+	_nameOffsets.reserve(series.size() + 1);
+	_offsets.reserve(series.size() + 1);
+	_days.reserve(rows);
+	_rates.reserve(rows);
+	_fixedRates.reserve(rows);
+	for (it = series.begin(); it != series.end(); ++it)
+	{
+		const RateIndex& index = it->second;
+		_nameOffsets.push_back(static_cast<uint32_t>(_names.size()));
+		_names += it->first;
+		_offsets.push_back(_days.size());
+		if (index.empty())
+			continue;
+		_days.insert(_days.end(), index.days(), index.days() + index.size());
+		_rates.insert(_rates.end(), index.rates(), index.rates() + index.size());
+		_fixedRates.insert(_fixedRates.end(), index.fixedRates(), index.fixedRates() + index.size());
+	}
+	_nameOffsets.push_back(static_cast<uint32_t>(_names.size()));
+	_offsets.push_back(_days.size());
+}
+
+/**
+ * Empties the store.
+ */
+void AssetStore::clear()
+{
+	std::string().swap(_names);
+	std::vector<uint32_t>().swap(_nameOffsets);
+	std::vector<size_t>().swap(_offsets);
+	std::vector<uint32_t>().swap(_days);
+	std::vector<float>().swap(_rates);
+	std::vector<int64_t>().swap(_fixedRates);
+}
+
+/**
+ * @return true if the store holds no asset.
+ */
+bool AssetStore::empty() const
+{
+	return assets() == 0;
+}
+
+/**
+ * @return The number of assets.
+ */
+size_t AssetStore::assets() const
+{
+	return _offsets.empty() ? 0 : _offsets.size() - 1;
+}
+
+/**
+ * @return The number of rows of all assets.
+ */
+size_t AssetStore::size() const
+{
+	return _days.size();
+}
+
+/**
+ * Finds an asset by name.
+ *
+ * @param name The name, not null-terminated.
+ * @param len The length of the name.
+ * @return The asset number, or AssetStore::npos if the store has no such asset.
+ */
+size_t AssetStore::find(const char* name, size_t len) const
+{
+	size_t low = 0;
+	size_t high = assets();
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		const char* other = _names.data() + _nameOffsets[mid];
+		size_t otherLen = _nameOffsets[mid + 1] - _nameOffsets[mid];
+		int cmp = std::memcmp(other, name, std::min(otherLen, len));
+		if (cmp == 0 && otherLen != len)
+			cmp = (otherLen < len) ? -1 : 1;
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return npos;
+}
+
+/**
+ * @param asset An asset number returned by AssetStore::find.
+ * @return The name of the asset.
+ */
+std::string AssetStore::name(size_t asset) const
+{
+	return _names.substr(_nameOffsets[asset], _nameOffsets[asset + 1] - _nameOffsets[asset]);
+}
+
+/**
+ * Finds the row of an asset holding the given date or, failing that, the closest earlier date.
+ *
+ * @param asset An asset number returned by AssetStore::find.
+ * @param day The day number to look up.
+ * @return The position of the row in the store, or AssetStore::npos if every date of the asset
+ * is later than the requested one.
+ */
+size_t AssetStore::floor(size_t asset, uint32_t day) const
+{
+	size_t first = _offsets[asset];
+	size_t count = _offsets[asset + 1] - first;
+	if (count == 0)
+		return npos;
+	size_t pos = RateIndex::floorSearch(&_days[first], count, day);
+	return (pos == RateIndex::npos) ? npos : first + pos;
+}
+
+/**
+ * @param pos A position returned by AssetStore::floor.
+ * @return The day number stored at that position.
+ */
+uint32_t AssetStore::dayAt(size_t pos) const
+{
+	return _days[pos];
+}
+
+/**
+ * @param pos A position returned by AssetStore::floor.
+ * @return The exchange rate stored at that position.
+ */
+float AssetStore::rateAt(size_t pos) const
+{
+	return _rates[pos];
+}
+
+/**
+ * @param pos A position returned by AssetStore::floor.
+ * @return The exchange rate stored at that position, times 10^RateIndex::FIXED_SCALE.
+ */
+int64_t AssetStore::fixedRateAt(size_t pos) const
+{
+	return _fixedRates[pos];
+}
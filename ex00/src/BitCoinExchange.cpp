@@ -12,13 +12,23 @@
 
 #include "../inc/BitCoinExchange.hpp"
 #include "../inc/ansi.h"
+#include <pthread.h>
+#include <unistd.h>
 
 /**
  * Default constructor
  *
  * Initializes an empty BitCoinExchange object.
  */
-BitCoinExchange::BitCoinExchange() {}
+BitCoinExchange::BitCoinExchange()
+	: _tables(new Tables()), _useDense(false), _useRange(false), _exact(false), _colors(true), _useCache(false),
+	_useCompressed(false) {
+	_feed.device = 0;
+	_feed.inode = 0;
+	_feed.offset = 0;
+	_feed.lastRow = RateIndex::npos;
+	_feed.lastDay = 0;
+}
 
 /**
  * Copy constructor
@@ -27,9 +37,10 @@ BitCoinExchange::BitCoinExchange() {}
  *
  * @param other The object to copy from.
  */
-BitCoinExchange::BitCoinExchange(const BitCoinExchange& other) {
-	_database = other._database;
-}
+BitCoinExchange::BitCoinExchange(const BitCoinExchange& other)
+	: _tables(copyTables(other._tables)), _useDense(other._useDense), _useRange(other._useRange),
+	_exact(other._exact), _colors(other._colors), _useCache(other._useCache),
+	_useCompressed(other._useCompressed), _feed(other._feed) {}
 
 /**
  * Destructor
@@ -49,28 +60,20 @@ BitCoinExchange::~BitCoinExchange() {}
 BitCoinExchange& BitCoinExchange::operator=(const BitCoinExchange& other) {
 	if (this != &other)
 	{
-		_database = other._database;
+		Tables* next = copyTables(other._tables);
+		RcuPointer<Tables>::WriteGuard lock(_tables);
+		_useDense = other._useDense;
+		_useRange = other._useRange;
+		_exact = other._exact;
+		_colors = other._colors;
+		_useCache = other._useCache;
+		_useCompressed = other._useCompressed;
+		_feed = other._feed;
+		_tables.publish(next);
 	}
 	return *this;
 }
 
-/**
- * Checks if the given year is a leap year.
- *
- * A leap year is a year that is exactly divisible by four, except for years
- * that are exactly divisible by 100, but these years are leap years if they
- * are exactly divisible by 400. For example, the years 1700, 1800, and 1900
- * are not leap years, but the years 1600 and 2000 are.
- *
- * @param year The year to check.
- * @return true if the year is a leap year, false otherwise.
- */
-bool BitCoinExchange::isLeapYear(int year) const {
-	if (year % 4 != 0) return false;
-	if (year % 100 != 0) return true;
-	return (year % 400 == 0);
-}
-
 /**
  * Checks if the given date string is in a valid format and represents a valid calendar date.
  *
@@ -84,49 +87,15 @@ bool BitCoinExchange::isLeapYear(int year) const {
  * - The month is between 1 and 12.
  * - The day is within valid range for the given month and year, accounting for leap years.
  *
+ * Validation is done in a single pass by Date::parse, which also produces the packed day number
+ * used by the lookup structures, so the date is never parsed twice.
+ *
  * @param date The date string to validate.
+ * @param day Receives the day number of the date if it is valid.
  * @return true if the date is valid, false otherwise.
  */
-
-bool BitCoinExchange::isValidDate(const std::string& date) const {
-	if (date.length() != 10) return false;
-	for (int i = 0; i < 10; i++)
-	{
-		if (i == 4 || i == 7)
-		{
-			if (date[i] != '-') return false;
-		} else if (!std::isdigit(date[i]))
-		{
-			return false;
-		}
-	}
-
-	std::string yearStr = date.substr(0, 4);
-	std::string monthStr = date.substr(5, 2);
-	std::string dayStr = date.substr(8, 2);
-
-	int year = std::atoi(yearStr.c_str());
-	int month = std::atoi(monthStr.c_str());
-	int day = std::atoi(dayStr.c_str());
-
-	if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31)
-		return false;
-
-	if (month == 2)
-	{
-		if (isLeapYear(year))
-		{
-			if (day > 29) return false;
-		} else
-		{
-			if (day > 28) return false;
-		}
-	} else if (month == 4 || month == 6 || month == 9 || month == 11)
-	{
-		if (day > 30)
-			return false;
-	}
-	return true;
+bool BitCoinExchange::isValidDate(const std::string& date, uint32_t& day) const {
+	return Date::parse(date, day);
 }
 
 /**
@@ -139,32 +108,37 @@ bool BitCoinExchange::isValidDate(const std::string& date) const {
  *
  * @param valueStr The string to validate.
  * @param value The validated float value.
+ * @param out The buffer receiving the error line if the value is invalid.
  * @return true if the string is a valid positive float, false otherwise.
  */
-bool BitCoinExchange::isValidValue(const std::string& valueStr, float& value) const {
+bool BitCoinExchange::isValidValue(const std::string& valueStr, float& value, OutputBuffer& out) const {
 	std::istringstream iss(valueStr);
 	if (!(iss >> value))
 	{
-		std::cout << BRED "Error: bad input => " << valueStr << RESET << std::endl;
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: bad input => ", valueStr.data(), valueStr.size());
 		return false;
 	}
 
 	char c;
 	if (iss >> c)
 	{
-		std::cout << BRED "Error: bad input => " << valueStr << RESET << std::endl;
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: bad input => ", valueStr.data(), valueStr.size());
 		return false;
 	}
 
 	if (value < 0)
 	{
-		std::cout << BRED "Error: not a positive number." RESET << std::endl;
+		BTC_STATS_COUNT(LINES_NEGATIVE);
+		appendError(out, "Error: not a positive number.");
 		return false;
 	}
 
 	if (value > 1000)
 	{
-		std::cout << BRED "Error: too large a number." RESET << std::endl;
+		BTC_STATS_COUNT(LINES_TOO_LARGE);
+		appendError(out, "Error: too large a number.");
 		return false;
 	}
 	return true;
@@ -173,7 +147,7 @@ bool BitCoinExchange::isValidValue(const std::string& valueStr, float& value) co
 /**
  * Finds the exchange rate for a given date.
  *
- * The function searches the database for an entry with a date equal to the given date.
+ * The function searches the rate index for an entry with a date equal to the given date.
  * If such an entry exists, the exchange rate associated with that entry is returned.
  *
  * If no entry with the given date exists, the function searches for the entry with the
@@ -181,127 +155,1723 @@ bool BitCoinExchange::isValidValue(const std::string& valueStr, float& value) co
  *
  * If no entry with a date before the given date exists, a std::runtime_error is thrown.
  *
- * @param date The date for which to find the exchange rate.
+ * When a date cache entry is given, a rate it already holds is returned without searching, and
+ * the outcome of a search is stored into it.
+ *
+ * @param day The day number of the date for which to find the exchange rate.
+ * @param entry The date cache entry of the date, or NULL.
  * @return The exchange rate associated with the given date, or the closest date before that.
  * @throw std::runtime_error if no entry with a date before the given date exists.
  */
-float BitCoinExchange::getExchangeRate(const std::string& date) const {
-	std::map<std::string, float>::const_iterator it = _database.lower_bound(date);
-	if (it != _database.end() && it->first == date)
+float BitCoinExchange::getExchangeRate(uint32_t day, DateCache::Entry* entry) const {
+	float rate = 0;
+	bool found;
+	if (entry && entry->state >= DateCache::NO_RATE)
 	{
-		return it->second;
+		rate = entry->rate;
+		found = (entry->state == DateCache::FOUND);
 	}
-
-	if (it == _database.begin())
+	else
+	{
+		RcuPointer<Tables>::ReadGuard tables(_tables);
+		BTC_STATS_TIMER(lookup, STAGE_LOOKUP);
+		found = findRate(*tables, day, rate);
+		BTC_STATS_STOP(lookup);
+		BTC_STATS_ONLY(if (found) countLookup(*tables, day));
+		if (entry)
+		{
+			entry->state = found ? DateCache::FOUND : DateCache::NO_RATE;
+			entry->rate = rate;
+		}
+	}
+	if (!found)
 	{
 		throw std::runtime_error("no data available for this date or before.");
 	}
-	--it;
-	return it->second;
+	return rate;
 }
 
 /**
- * Loads the exchange rate database from a file.
+ * Looks up the rate of a date given as a day number.
  *
- * The file should contain a header line (which is skipped), followed by lines of the form:
- * date,rate
- * where date is a string in the format "YYYY-MM-DD" and rate is a float.
+ * Uses the dense day table when it is built, then the compressed history when the index was
+ * compressed, and the rate index search otherwise.
  *
- * The function reads the file line by line and stores each valid date and exchange rate in the
- * database.
- *
- * @param filename The name of the file to load the database from.
- * @throw std::runtime_error if the file cannot be opened.
+ * @param tables The lookup tables to search.
+ * @param day The day number to look up.
+ * @param rate Receives the rate of that date or of the closest earlier date.
+ * @return true if a rate was found, false if every rate is later than the date.
  */
-void BitCoinExchange::loadDatabase(const std::string& filename) {
-	std::ifstream file(filename.c_str());
-	if (!file.is_open())
+bool BitCoinExchange::findRate(const Tables& tables, uint32_t day, float& rate) {
+	if (!tables.dense.empty())
+		return tables.dense.lookup(day, rate);
+	if (!tables.compressed.empty())
 	{
-		throw std::runtime_error("could not open database file.");
+		CompressedIndex::Row row;
+		if (!tables.compressed.floor(day, row))
+			return false;
+		rate = row.rate;
+		return true;
 	}
 
-	std::string line;
-	std::getline(file, line); // Skip header
+	size_t pos = tables.index.floor(day);
+	if (pos == RateIndex::npos)
+		return false;
+	rate = tables.index.rateAt(pos);
+	return true;
+}
 
-	while (std::getline(file, line))
-	{
-		size_t pos = line.find(',');
-		if (pos == std::string::npos) continue;
+/**
+ * Looks up the rate of a date in the history of one asset.
+ *
+ * @param assets The asset store to search.
+ * @param asset The asset number.
+ * @param day The day number to look up.
+ * @param rate Receives the rate of that date or of the closest earlier date.
+ * @param fixedRate Receives the same rate times 10^RateIndex::FIXED_SCALE.
+ * @return true if a rate was found, false if every rate of the asset is later than the date.
+ */
+bool BitCoinExchange::findAssetRate(const AssetStore& assets, size_t asset, uint32_t day, float& rate,
+	int64_t& fixedRate) {
+	size_t pos = assets.floor(asset, day);
+	if (pos == AssetStore::npos)
+		return false;
+	rate = assets.rateAt(pos);
+	fixedRate = assets.fixedRateAt(pos);
+	return true;
+}
 
-		std::string date = line.substr(0, pos);
-		std::string rateStr = line.substr(pos + 1);
+/**
+ * Retrieves the exact exchange rate of a date given as a day number, for exact valuations.
+ *
+ * Uses and fills a date cache entry like getExchangeRate does.
+ *
+ * @param day The day number to look up.
+ * @param entry The date cache entry of the date, or NULL.
+ * @return The rate of that date or of the closest earlier date, times 10^RateIndex::FIXED_SCALE.
+ * @throw std::runtime_error if no rate is available on or before the date.
+ */
+int64_t BitCoinExchange::getFixedExchangeRate(uint32_t day, DateCache::Entry* entry) const {
+	int64_t rate = 0;
+	bool found;
+	if (entry && entry->state >= DateCache::NO_RATE)
+	{
+		rate = entry->fixedRate;
+		found = (entry->state == DateCache::FOUND);
+	}
+	else
+	{
+		RcuPointer<Tables>::ReadGuard tables(_tables);
+		BTC_STATS_TIMER(lookup, STAGE_LOOKUP);
+		found = findFixedRate(*tables, day, rate);
+		BTC_STATS_STOP(lookup);
+		BTC_STATS_ONLY(if (found) countLookup(*tables, day));
+		if (entry)
+		{
+			entry->state = found ? DateCache::FOUND : DateCache::NO_RATE;
+			entry->fixedRate = rate;
+		}
+	}
+	if (!found)
+	{
+		throw std::runtime_error("no data available for this date or before.");
+	}
+	return rate;
+}
 
-		std::istringstream iss(rateStr);
-		float rate;
-		iss >> rate;
-		if (iss.fail()) continue;
+/**
+ * @return The version of the current lookup tables, which changes whenever they are replaced.
+ */
+uint64_t BitCoinExchange::tablesVersion() const {
+	RcuPointer<Tables>::ReadGuard tables(_tables);
+	return tables->version;
+}
 
-		_database[date] = rate;
+/**
+ * Validates a date through its date cache entry.
+ *
+ * A date the entry already knows is not parsed again; otherwise it is parsed with Date::parse and
+ * the outcome is stored into the entry.
+ *
+ * @param entry The date cache entry of the date, or NULL to always parse.
+ * @param date The trimmed date text.
+ * @param len The length of the text.
+ * @param day Receives the day number of the date if it is valid.
+ * @return true if the date is valid, false otherwise.
+ */
+bool BitCoinExchange::cachedDate(DateCache::Entry* entry, const char* date, size_t len, uint32_t& day) {
+	if (entry && entry->state != DateCache::EMPTY)
+	{
+		day = entry->day;
+		return entry->state != DateCache::BAD_DATE;
+	}
+	bool valid = Date::parse(date, len, day);
+	if (entry)
+	{
+		entry->state = valid ? DateCache::VALID_DATE : DateCache::BAD_DATE;
+		entry->day = valid ? day : 0;
 	}
+	return valid;
 }
 
 /**
- * Processes a file containing lines of the form "date|value".
+ * Looks up the fixed-point rate of a date given as a day number.
  *
- * The function reads the file line by line, and for each line, it extracts the date and value, and
- * prints to the console the date, value, and result of multiplying the value by the exchange rate
- * for that date. If the input line is invalid, an error message is printed instead.
+ * Searches the compressed history or the rate index: the dense table only holds float rates.
  *
- * @param filename The name of the file to process.
- * @throw std::runtime_error if the file cannot be opened.
+ * @param tables The lookup tables to search.
+ * @param day The day number to look up.
+ * @param rate Receives the rate times 10^RateIndex::FIXED_SCALE.
+ * @return true if a rate was found, false if every rate is later than the date.
  */
-void BitCoinExchange::processInputFile(const std::string& filename) const {
-	std::ifstream file(filename.c_str());
-	if (!file.is_open())
+bool BitCoinExchange::findFixedRate(const Tables& tables, uint32_t day, int64_t& rate) {
+	if (!tables.compressed.empty())
 	{
-		throw std::runtime_error("could not open file.");
+		CompressedIndex::Row row;
+		if (!tables.compressed.floor(day, row))
+			return false;
+		rate = row.fixedRate;
+		return true;
 	}
 
-	std::string line;
-	std::getline(file, line); // Skip header
+	size_t pos = tables.index.floor(day);
+	if (pos == RateIndex::npos)
+		return false;
+	rate = tables.index.fixedRateAt(pos);
+	return true;
+}
 
-	while (std::getline(file, line))
+/**
+ * Formats the exact value of an amount at a fixed-point rate, rounded to cents.
+ *
+ * The amount is read from its text at the scale it is written with, so the product is computed
+ * on the decimal numbers as written rather than on their float approximations. The product of
+ * two 64-bit integers is computed on 128 bits, then rounded half away from zero to cents.
+ *
+ * @param valueBegin The first character of a valid amount.
+ * @param valueEnd One past its last character.
+ * @param rate The rate times 10^RateIndex::FIXED_SCALE.
+ * @param buffer Receives the value with two decimals; 24 bytes are enough.
+ * @return The length of the text, or 0 if the amount or the rate has no exact fixed-point form
+ * (see Decimal::parseExact and RateIndex::INEXACT_RATE).
+ */
+size_t BitCoinExchange::formatExact(const char* valueBegin, const char* valueEnd, int64_t rate, char* buffer) {
+	int64_t amount;
+	int scale;
+	if (rate == RateIndex::INEXACT_RATE || !Decimal::parseExact(valueBegin, valueEnd, amount, scale))
+		return 0;
+
+	__int128 product = static_cast<__int128>(amount) * rate;
+	int dropped = scale + RateIndex::FIXED_SCALE - 2;
+	__int128 unit = 1;
+	for (int i = 0; i < dropped; i++)
+		unit *= 10;
+	__int128 cents = product / unit;
+	__int128 remainder = product % unit;
+	if (remainder < 0)
+		remainder = -remainder;
+	if (remainder >= unit - remainder)
+		cents += (product > 0) ? 1 : -1;
+	return Decimal::formatFixed(static_cast<int64_t>(cents), 2, buffer);
+}
+
+/**
+ * Enables or disables exact valuations.
+ *
+ * When enabled, results are computed from fixed-point amounts and rates read from the decimal
+ * text of the input and the database, and printed without going through a float. When disabled,
+ * results are the float products printed by the original program.
+ *
+ * @param enable true for exact valuations, false for float valuations.
+ */
+void BitCoinExchange::useExactArithmetic(bool enable) {
+	_exact = enable;
+}
+
+/**
+ * Enables or disables the ANSI color codes around result and error lines.
+ *
+ * Colors are enabled by default; they are best disabled when the output is not a terminal.
+ *
+ * @param enable true to color lines, false to print plain text.
+ */
+void BitCoinExchange::useColors(bool enable) {
+	_colors = enable;
+}
+
+/**
+ * Enables or disables the date cache in front of the rate lookups (see DateCache).
+ *
+ * The cache does not change any result: with it, a date repeated in the input is neither
+ * validated nor searched again.
+ *
+ * @param enable true to memoize dates, false to resolve every line.
+ */
+void BitCoinExchange::useDateCache(bool enable) {
+	_useCache = enable;
+}
+
+/**
+ * Counts a successful lookup as an exact date hit or as a rate carried forward from an earlier
+ * date. Only called by instrumented builds, outside of the timed lookup.
+ *
+ * @param tables The lookup tables searched.
+ * @param day The day number looked up.
+ */
+void BitCoinExchange::countLookup(const Tables& tables, uint32_t day) {
+	CompressedIndex::Row row;
+	size_t pos = tables.index.floor(day);
+	if (!tables.compressed.empty() ? tables.compressed.floor(day, row) && row.day == day
+		: pos != RateIndex::npos && tables.index.dayAt(pos) == day)
+		Stats::count(Stats::LOOKUP_EXACT);
+	else
+		Stats::count(Stats::LOOKUP_CARRIED);
+}
+
+/**
+ * Makes a private copy of the lookup tables currently published by another object.
+ *
+ * @param tables The published tables to copy.
+ * @return The copy, allocated with new.
+ */
+BitCoinExchange::Tables* BitCoinExchange::copyTables(const RcuPointer<Tables>& tables) {
+	RcuPointer<Tables>::ReadGuard current(tables);
+	return new Tables(*current);
+}
+
+/**
+ * Brings back the rate index of tables whose history was compressed, so that it can be extended.
+ *
+ * @param tables The tables to restore; left untouched if their index was not dropped.
+ */
+void BitCoinExchange::restoreIndex(Tables& tables) {
+	if (tables.index.empty() && !tables.compressed.empty())
+		tables.compressed.decompress(tables.index);
+}
+
+/**
+ * Gives access to the whole history of tables as a rate index.
+ *
+ * @param tables The tables to read.
+ * @param scratch Receives the decompressed rows when the history was compressed.
+ * @return The rate index of the tables, or scratch.
+ */
+const RateIndex& BitCoinExchange::historyOf(const Tables& tables, RateIndex& scratch) {
+	if (tables.index.empty() && !tables.compressed.empty())
 	{
-		size_t pos;
-		std::string date;
-		std::string valueStr;
-		float value;
-		float rate;
-		float result;
+		tables.compressed.decompress(scratch);
+		return scratch;
+	}
+	return tables.index;
+}
 
-		pos = line.find('|');
-		if (pos == std::string::npos)
+/**
+ * Finishes a new set of lookup tables and publishes it. The caller holds the writer lock.
+ *
+ * The tables get a new version number, so that date caches bound to the previous tables are
+ * emptied. The dense and range tables are built (or dropped) according to useDenseTable and
+ * useRangeTable, and the history is compressed according to useCompressedHistory, which frees
+ * the rate index. Then the tables replace the current ones with an atomic pointer swap; the
+ * previous tables are freed once no reader uses them anymore.
+ *
+ * @param next The new tables, allocated with new. Ownership is taken even on failure.
+ */
+void BitCoinExchange::publish(Tables* next) {
+	static volatile uint64_t versions = 0;
+	next->version = __atomic_add_fetch(&versions, 1, __ATOMIC_RELAXED);
+	try {
+		restoreIndex(*next);
+		if (_useDense)
+			next->dense.build(next->index);
+		else
+			next->dense.clear();
+		if (_useRange)
+			next->range.build(next->index);
+		else
+			next->range.clear();
+		if (_useCompressed)
 		{
-			std::cout << BRED "Error: bad input => " << line << RESET << std::endl;
-			continue;
+			next->compressed.build(next->index);
+			next->index.clear();
 		}
+		else
+			next->compressed.clear();
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	_tables.publish(next);
+}
 
-		date = line.substr(0, pos);
-		valueStr = line.substr(pos + 1);
+/**
+ * Enables or disables the dense day table.
+ *
+ * When enabled, a table with one carried-forward rate per calendar day between the first and the
+ * last date of the database is built (and rebuilt after every load), turning each lookup into an
+ * array access. Histories spanning more than DenseRateTable::MAX_DAYS days keep using the search.
+ *
+ * @param enable true to build and use the table, false to drop it.
+ */
+void BitCoinExchange::useDenseTable(bool enable) {
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	_useDense = enable;
+	publish(new Tables(_tables.current()));
+}
 
-		// Trim whitespace
-		date.erase(date.find_last_not_of(" \t") + 1);
-		date.erase(0, date.find_first_not_of(" \t"));
-		valueStr.erase(valueStr.find_last_not_of(" \t") + 1);
-		valueStr.erase(0, valueStr.find_first_not_of(" \t"));
+/**
+ * Enables or disables the range table.
+ *
+ * When enabled, the prefix sums and sparse table answering summarizeRange are built (and rebuilt
+ * after every load), so that each range is summarized in constant time. Otherwise every call to
+ * summarizeRange builds a temporary table, which costs a pass over the history.
+ *
+ * @param enable true to build and keep the table, false to drop it.
+ */
+void BitCoinExchange::useRangeTable(bool enable) {
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	_useRange = enable;
+	publish(new Tables(_tables.current()));
+}
 
-		if (!isValidDate(date))
-		{
-			std::cout << BRED "Error: bad input => " << date << RESET << std::endl;
-			continue;
-		}
+/**
+ * Enables or disables the compressed rate history.
+ *
+ * When enabled, the rate index is replaced after every load by a CompressedIndex, which keeps the
+ * same rows, float and fixed-point rates included, in a fraction of the memory. Lookups then
+ * decode part of one block instead of searching flat arrays; the dense table, when enabled, is
+ * still used first. Batched valuations and range summaries decompress the history on each call.
+ *
+ * @param enable true to compress the history, false to keep the flat index.
+ */
+void BitCoinExchange::useCompressedHistory(bool enable) {
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	_useCompressed = enable;
+	publish(new Tables(_tables.current()));
+}
+
+/**
+ * Summarizes the exchange rates in effect between two dates.
+ *
+ * See RangeTable::query for the aggregates computed.
+ *
+ * @param from The first date of the range, in the format "YYYY-MM-DD".
+ * @param to The last date of the range, included.
+ * @param summary Receives the aggregates.
+ * @return true on success, false if no rate is in effect in the range.
+ * @throw std::runtime_error if a date is invalid or the range is reversed.
+ */
+bool BitCoinExchange::summarizeRange(const std::string& from, const std::string& to, RangeTable::Summary& summary) const {
+	uint32_t first;
+	uint32_t last;
+	if (!Date::parse(from, first))
+		throw std::runtime_error("bad input => " + from);
+	if (!Date::parse(to, last))
+		throw std::runtime_error("bad input => " + to);
+	if (last < first)
+		throw std::runtime_error("reversed date range.");
 
-		if (!isValidValue(valueStr, value))
+	RcuPointer<Tables>::ReadGuard tables(_tables);
+	RateIndex scratch;
+	const RateIndex& index = historyOf(*tables, scratch);
+	if (!tables->range.empty() || index.empty())
+		return tables->range.query(index, first, last, summary);
+
+	RangeTable range;
+	range.build(index);
+	return range.query(index, first, last, summary);
+}
+
+/**
+ * Reads a rate from its CSV text as a fixed-point integer for exact valuations.
+ *
+ * @param begin The first character of the rate.
+ * @param end One past its last character.
+ * @return The rate times 10^RateIndex::FIXED_SCALE, or RateIndex::INEXACT_RATE if the text
+ * needs more decimals than that or cannot be represented exactly.
+ */
+static int64_t parseFixedRate(const char* begin, const char* end)
+{
+	int64_t value;
+	int scale;
+	int64_t fixedRate;
+	if (!Decimal::parseExact(begin, end, value, scale) || scale > RateIndex::FIXED_SCALE
+		|| !Decimal::rescale(value, RateIndex::FIXED_SCALE - scale, fixedRate))
+		return RateIndex::INEXACT_RATE;
+	return fixedRate;
+}
+
+/**
+ * Parses the rows of a mapped CSV rate file, starting at the offset recorded in a feed.
+ *
+ * At offset zero the header line is skipped first. The rows are lines of the form:
+ * date,rate
+ * where date is a string in the format "YYYY-MM-DD" and rate is a float.
+ *
+ * The file is scanned in place: each row is split with memchr and its date and rate are parsed
+ * straight from the mapped bytes, so no per-row string or stream is allocated. Valid rows are
+ * appended to the index, which the caller freezes. Rows whose date is not a valid calendar date
+ * or whose rate cannot be parsed are skipped. The rate is read twice from the text: as a float,
+ * and as a fixed-point integer for exact valuations (see parseFixedRate).
+ *
+ * The feed is advanced past the last complete (newline-terminated) line, and remembers where the
+ * last valid complete row starts and its date. A trailing line without a newline is parsed but
+ * neither consumed nor remembered: it lies past the load offset, where continuesFeed could not
+ * check it, and is read again, completed, by the next incremental load.
+ *
+ * @param file The mapped CSV file.
+ * @param feed The load position, updated.
+ * @param index The index receiving the rows.
+ */
+void BitCoinExchange::parseRows(const MappedFile& file, Feed& feed, RateIndex& index) {
+	const char* data = file.data();
+	const char* p = data + feed.offset;
+	const char* end = data + file.size();
+
+	// Shortest possible row is "YYYY-MM-DD,0\n"
+	index.reserve(index.size() + (end - p) / 13);
+
+	if (feed.offset == 0)
+	{
+		const char* eol = p ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : NULL;
+		if (!eol)
+			return;
+		p = eol + 1; // Skip header
+		feed.offset = static_cast<size_t>(p - data);
+	}
+
+	while (p < end)
+	{
+		const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (!eol) eol = end;
+
+		const char* comma = static_cast<const char*>(std::memchr(p, ',', eol - p));
+		uint32_t day;
+		float rate;
+		if (comma && Date::parse(p, comma - p, day) && Decimal::parseFloat(comma + 1, eol, rate))
 		{
-			continue;
+			index.insert(day, rate, parseFixedRate(comma + 1, eol));
+			if (eol < end)
+			{
+				feed.lastRow = static_cast<size_t>(p - data);
+				feed.lastDay = day;
+			}
 		}
+		if (eol == end)
+			break;
+		p = eol + 1;
+		feed.offset = static_cast<size_t>(p - data);
+	}
+}
 
-		try {
-			rate = getExchangeRate(date);
-			result = value * rate;
-			std::cout << BGRN << date << " => " << valueStr << " = " << std::fixed << std::setprecision(2) << result << RESET << std::endl;
-		} catch (const std::exception& e) {
-			std::cout << BRED "Error: " << e.what() << RESET << std::endl;
+/**
+ * Parses a whole CSV rate file into a rate index and starts a feed on it.
+ *
+ * @param filename The name of the file to parse.
+ * @param feed Receives the identity of the file and the load position.
+ * @param index The index receiving the rows, frozen on return.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::parseDatabase(const std::string& filename, Feed& feed, RateIndex& index) {
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		throw std::runtime_error("could not open database file.");
+	}
+	startFeed(filename, file, feed);
+	parseRows(file, feed, index);
+	index.freeze();
+}
+
+/**
+ * Starts a feed at the beginning of a file.
+ *
+ * @param filename The name of the file.
+ * @param file The mapped file.
+ * @param feed Receives the identity of the file and a zero load position.
+ */
+void BitCoinExchange::startFeed(const std::string& filename, const MappedFile& file, Feed& feed) {
+	feed.filename = filename;
+	feed.device = file.device();
+	feed.inode = file.inode();
+	feed.offset = 0;
+	feed.lastRow = RateIndex::npos;
+	feed.lastDay = 0;
+}
+
+/**
+ * Checks that a file is the one a feed was loaded from, with rows only appended since.
+ *
+ * The file must be the same inode, at least as long as the loaded part, with a line boundary at
+ * the load offset and the last loaded row still carrying the same date. A replaced, truncated or
+ * rewritten file fails one of these checks and must be loaded again from the top.
+ *
+ * @param filename The name of the file.
+ * @param file The mapped file.
+ * @param feed The feed to check.
+ * @return true if the rows after the feed offset can simply be added.
+ */
+bool BitCoinExchange::continuesFeed(const std::string& filename, const MappedFile& file, const Feed& feed) {
+	if (filename != feed.filename || file.device() != feed.device || file.inode() != feed.inode)
+		return false;
+	if (file.size() < feed.offset || (feed.offset > 0 && file.data()[feed.offset - 1] != '\n'))
+		return false;
+	if (feed.lastRow == RateIndex::npos)
+		return true;
+
+	uint32_t day;
+	const char* row = file.data() + feed.lastRow;
+	return feed.lastRow + 10 < feed.offset && row[10] == ','
+		&& Date::parse(row, 10, day) && day == feed.lastDay;
+}
+
+/**
+ * Moves a feed to the end of a file whose rows were loaded by other means (a snapshot).
+ *
+ * Only the last complete line is looked at, to find the load offset and the last row.
+ *
+ * @param file The mapped file.
+ * @param feed The feed to move, started on the file.
+ */
+void BitCoinExchange::seekFeedEnd(const MappedFile& file, Feed& feed) {
+	const char* data = file.data();
+	const char* end = data + file.size();
+	const char* eol = data ? static_cast<const char*>(memrchr(data, '\n', end - data)) : NULL;
+	if (!eol)
+		return;
+	feed.offset = static_cast<size_t>(eol + 1 - data);
+
+	const char* prev = static_cast<const char*>(memrchr(data, '\n', eol - data));
+	if (!prev)
+		return; // Only the header is complete
+
+	const char* row = prev + 1;
+	const char* comma = static_cast<const char*>(std::memchr(row, ',', eol - row));
+	uint32_t day;
+	float rate;
+	if (comma && Date::parse(row, comma - row, day) && Decimal::parseFloat(comma + 1, eol, rate))
+	{
+		feed.lastRow = static_cast<size_t>(row - data);
+		feed.lastDay = day;
+	}
+}
+
+/**
+ * Loads the exchange rate database from a file.
+ *
+ * The rows of the file (see parseRows) are added to the rates already loaded. The update is
+ * built on a copy of the current tables and published atomically, so concurrent lookups keep
+ * seeing the previous database until the new one is complete.
+ *
+ * The file becomes the feed followed by refreshDatabase.
+ *
+ * @param filename The name of the file to load the database from.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::loadDatabase(const std::string& filename) {
+	BTC_STATS_TIMER(load, STAGE_LOAD);
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	Tables* next = new Tables(_tables.current());
+	Feed feed;
+	try {
+		restoreIndex(*next);
+		parseDatabase(filename, feed, next->index);
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	publish(next);
+	_feed = feed;
+}
+
+/**
+ * Parses a rate file of one or many assets.
+ *
+ * A file whose header has three columns holds rows of the form:
+ * asset,date,rate
+ * and may mix any number of assets. Any other file holds "date,rate" rows of a single asset,
+ * named after the file without its directory and extension (rates/ETH.csv holds ETH). Rows are
+ * parsed in place like parseRows does, and invalid rows are skipped.
+ *
+ * @param filename The name of the file.
+ * @param series The history of each asset, receiving the rows. The caller freezes them.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::parseAssetFile(const std::string& filename, std::map<std::string, RateIndex>& series) {
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		throw std::runtime_error("could not open database file " + filename + ".");
+	}
+
+	const char* p = file.data();
+	const char* end = p + file.size();
+	const char* eol = p ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : NULL;
+	if (!eol)
+		return;
+	bool assetColumn = std::count(p, eol, ',') >= 2;
+	p = eol + 1; // Skip header
+
+	RateIndex* current = NULL;
+	std::string currentName;
+	if (!assetColumn)
+	{
+		size_t slash = filename.rfind('/');
+		std::string base = filename.substr(slash == std::string::npos ? 0 : slash + 1);
+		current = &series[base.substr(0, base.rfind('.'))];
+	}
+
+	while (p < end)
+	{
+		eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (!eol) eol = end;
+
+		const char* row = p;
+		p = (eol < end) ? eol + 1 : end;
+		if (assetColumn)
+		{
+			const char* comma = static_cast<const char*>(std::memchr(row, ',', eol - row));
+			if (!comma || comma == row)
+				continue;
+			size_t len = static_cast<size_t>(comma - row);
+			if (!current || currentName.size() != len || currentName.compare(0, len, row, len) != 0)
+			{
+				currentName.assign(row, len);
+				current = &series[currentName];
+			}
+			row = comma + 1;
+		}
+
+		const char* comma = static_cast<const char*>(std::memchr(row, ',', eol - row));
+		uint32_t day;
+		float rate;
+		if (comma && Date::parse(row, comma - row, day) && Decimal::parseFloat(comma + 1, eol, rate))
+		{
+			current->insert(day, rate, parseFixedRate(comma + 1, eol));
+		}
+	}
+}
+
+/**
+ * Loads the rate histories of many assets into the asset store.
+ *
+ * Rows of the same asset may be spread over several files; as in a single database, the last
+ * row read for a date wins. The previous content of the asset store is replaced.
+ *
+ * @param filenames The rate files (see parseAssetFile).
+ * @throw std::runtime_error if a file cannot be opened; the current store is then kept.
+ */
+void BitCoinExchange::loadAssets(const std::vector<std::string>& filenames) {
+	BTC_STATS_TIMER(load, STAGE_LOAD);
+	std::map<std::string, RateIndex> series;
+	for (size_t i = 0; i < filenames.size(); i++)
+		parseAssetFile(filenames[i], series);
+	std::map<std::string, RateIndex>::iterator it;
+	for (it = series.begin(); it != series.end(); ++it)
+		it->second.freeze();
+
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	Tables* next = new Tables(_tables.current());
+	try {
+		next->assets.build(series);
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	publish(next);
+}
+
+/**
+ * Replaces the exchange rate database with the current content of a file.
+ *
+ * This is the hot reload path: a brand new index is parsed and built while lookups keep running
+ * against the current one, then it is published with an atomic pointer swap. Lookups never wait
+ * and never see a partially built index; the old index is freed once its last reader is done.
+ *
+ * @param filename The name of the file to load the database from.
+ * @throw std::runtime_error if the file cannot be opened; the current database is then kept.
+ */
+void BitCoinExchange::reloadDatabase(const std::string& filename) {
+	BTC_STATS_TIMER(load, STAGE_LOAD);
+	Tables* next = new Tables();
+	Feed feed;
+	try {
+		parseDatabase(filename, feed, next->index);
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	publish(next);
+	_feed = feed;
+}
+
+/**
+ * Loads the rows appended to the database file since it was last loaded.
+ *
+ * The byte offset and the last row loaded from the file are remembered by every load, so only
+ * the appended lines are parsed. They are frozen on their own and merged into a copy of the
+ * current index (see RateIndex::merge): rows dated after the history are appended, and rows
+ * going back in time only rewrite the index from their date on. When the file is not the one
+ * the feed was loaded from, or was truncated or rewritten, it is loaded again from the top
+ * instead, replacing the current rates (see reloadDatabase).
+ *
+ * @param filename The name of the file to load the rows from.
+ * @return The number of distinct dates parsed.
+ * @throw std::runtime_error if the file cannot be opened; the current database is then kept.
+ */
+size_t BitCoinExchange::refreshDatabase(const std::string& filename) {
+	BTC_STATS_TIMER(load, STAGE_LOAD);
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		throw std::runtime_error("could not open database file.");
+	}
+
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	Feed feed = _feed;
+	RateIndex rows;
+	bool append = continuesFeed(filename, file, feed);
+	if (!append)
+		startFeed(filename, file, feed);
+	parseRows(file, feed, rows);
+	rows.freeze();
+
+	if (append && rows.empty())
+	{
+		_feed = feed;
+		return 0;
+	}
+
+	Tables* next = append ? new Tables(_tables.current()) : new Tables();
+	try {
+		restoreIndex(*next);
+		if (append)
+			next->index.merge(rows);
+		else
+			next->index = rows;
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	publish(next);
+	_feed = feed;
+	return rows.size();
+}
+
+/**
+ * Loads the exchange rate database through a binary snapshot.
+ *
+ * The snapshot lives next to the CSV file, in "<filename>.snap". When it exists and was built
+ * from the current version of the CSV file (same size and modification time), it is memory
+ * mapped and searched in place, so startup costs a header check regardless of the history
+ * length. Otherwise the CSV file is parsed and the snapshot is rebuilt; failing to write it is
+ * not an error, the next run simply parses the CSV file again.
+ *
+ * The snapshot is only used when the database is empty, since it describes the CSV file alone.
+ *
+ * @param filename The name of the CSV file to load the database from.
+ * @throw std::runtime_error if the CSV file cannot be opened.
+ */
+void BitCoinExchange::loadCachedDatabase(const std::string& filename) {
+	BTC_STATS_TIMER(load, STAGE_LOAD);
+	MappedFile file;
+	Snapshot::Source source;
+	if (!file.open(filename) || !Snapshot::describe(filename, source))
+	{
+		throw std::runtime_error("could not open database file.");
+	}
+
+	RcuPointer<Tables>::WriteGuard lock(_tables);
+	bool empty = _tables.current().index.empty() && _tables.current().compressed.empty();
+	Tables* next = empty ? new Tables() : new Tables(_tables.current());
+	std::string snapshot = filename + ".snap";
+	bool mapped = false;
+	Feed feed;
+	startFeed(filename, file, feed);
+	try {
+		restoreIndex(*next);
+		mapped = empty && Snapshot::map(snapshot, source, next->index);
+		if (mapped)
+			seekFeedEnd(file, feed);
+		else
+		{
+			parseRows(file, feed, next->index);
+			next->index.freeze();
+		}
+	} catch (...) {
+		delete next;
+		throw;
+	}
+	if (empty && !mapped)
+		Snapshot::write(snapshot, next->index, source);
+	publish(next);
+	_feed = feed;
+}
+
+/**
+ * Processes a file containing lines of the form "date|value".
+ *
+ * The function reads the file line by line, and for each line, it extracts the date and value, and
+ * prints to the console the date, value, and result of multiplying the value by the exchange rate
+ * for that date. If the input line is invalid, an error message is printed instead.
+ *
+ * @param filename The name of the file to process.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::processInputFile(const std::string& filename) const {
+	std::ifstream file(filename.c_str());
+	if (!file.is_open())
+	{
+		throw std::runtime_error("could not open file.");
+	}
+
+	std::cout << std::flush;
+	OutputBuffer out(STDOUT_FILENO);
+	DateCache cache;
+	std::string line;
+	std::getline(file, line); // Skip header
+
+	while (std::getline(file, line))
+	{
+		size_t pos;
+		uint32_t day;
+		std::string date;
+		std::string valueStr;
+		float value;
+		float rate;
+		float result;
+		char number[64];
+		size_t len;
+
+		BTC_STATS_TIMER(split, STAGE_SPLIT);
+		pos = line.find('|');
+		if (pos == std::string::npos)
+		{
+			BTC_STATS_STOP(split);
+			BTC_STATS_COUNT(LINES_BAD_INPUT);
+			appendError(out, "Error: bad input => ", line.data(), line.size());
+			continue;
+		}
+
+		date = line.substr(0, pos);
+		valueStr = line.substr(pos + 1);
+
+		// Trim whitespace
+		date.erase(date.find_last_not_of(" \t") + 1);
+		date.erase(0, date.find_first_not_of(" \t"));
+		valueStr.erase(valueStr.find_last_not_of(" \t") + 1);
+		valueStr.erase(0, valueStr.find_first_not_of(" \t"));
+		BTC_STATS_STOP(split);
+
+		DateCache::Entry* entry = NULL;
+		if (_useCache)
+		{
+			cache.bind(tablesVersion());
+			entry = cache.lookup(date.data(), date.size());
+		}
+
+		BTC_STATS_TIMER(dateTimer, STAGE_DATE);
+		bool validDate = entry ? cachedDate(entry, date.data(), date.size(), day) : isValidDate(date, day);
+		BTC_STATS_STOP(dateTimer);
+		if (!validDate)
+		{
+			BTC_STATS_COUNT(LINES_BAD_INPUT);
+			appendError(out, "Error: bad input => ", date.data(), date.size());
+			continue;
+		}
+
+		BTC_STATS_TIMER(valueTimer, STAGE_VALUE);
+		bool validValue = isValidValue(valueStr, value, out);
+		BTC_STATS_STOP(valueTimer);
+		if (!validValue)
+		{
+			continue;
+		}
+
+		try {
+			if (_exact)
+			{
+				int64_t fixedRate = getFixedExchangeRate(day, entry);
+				BTC_STATS_TIMER(output, STAGE_OUTPUT);
+				len = formatExact(valueStr.data(), valueStr.data() + valueStr.size(), fixedRate, number);
+				if (len == 0)
+				{
+					BTC_STATS_COUNT(LINES_BAD_INPUT);
+					appendError(out, "Error: too many decimals for an exact value.");
+					continue;
+				}
+				BTC_STATS_COUNT(LINES_VALID);
+				appendResult(out, date.data(), date.size(), valueStr.data(), valueStr.size(), number, len);
+				continue;
+			}
+			rate = getExchangeRate(day, entry);
+			result = value * rate;
+			BTC_STATS_COUNT(LINES_VALID);
+			BTC_STATS_TIMER(output, STAGE_OUTPUT);
+			len = Decimal::formatFloat(result, 2, number);
+			appendResult(out, date.data(), date.size(), valueStr.data(), valueStr.size(), number, len);
+		} catch (const std::exception& e) {
+			BTC_STATS_COUNT(LINES_NO_RATE);
+			appendError(out, "Error: ", e.what(), std::strlen(e.what()));
+		}
+	}
+	out.flush();
+}
+
+/**
+ * Compares two query positions by date, used by valueBatch to sort a permutation of the queries.
+ */
+struct QueryOrder
+{
+	const std::vector<BitCoinExchange::Query>* queries;
+
+	bool operator()(size_t a, size_t b) const
+	{
+		return (*queries)[a].day < (*queries)[b].day;
+	}
+};
+
+/**
+ * Values a batch of (date, amount) queries.
+ *
+ * Instead of an independent search per query, the queries are visited in date order and resolved
+ * with a single merge walk over the rate index (see RateIndex::floorSorted). Batches that are
+ * already sorted are walked directly; otherwise a permutation is sorted by date and the results
+ * are scattered back, so they are always returned in the order of the queries.
+ *
+ * A query whose date precedes every rate in the database is returned with found set to false.
+ *
+ * @param queries The queries, as day numbers (see Date::parse) and amounts.
+ * @return One valuation per query, in the same order.
+ */
+std::vector<BitCoinExchange::Valuation> BitCoinExchange::valueBatch(const std::vector<Query>& queries) const {
+	size_t count = queries.size();
+	std::vector<Valuation> results(count);
+	if (count == 0)
+		return results;
+
+	bool sorted = true;
+	for (size_t i = 1; i < count && sorted; i++)
+		sorted = (queries[i - 1].day <= queries[i].day);
+
+	std::vector<size_t> order;
+	if (!sorted)
+	{
+		order.resize(count);
+		for (size_t i = 0; i < count; i++)
+			order[i] = i;
+		QueryOrder cmp;
+		cmp.queries = &queries;
+		std::sort(order.begin(), order.end(), cmp);
+	}
+
+	std::vector<uint32_t> days(count);
+	for (size_t i = 0; i < count; i++)
+		days[i] = queries[sorted ? i : order[i]].day;
+
+	RcuPointer<Tables>::ReadGuard tables(_tables);
+	RateIndex scratch;
+	const RateIndex& index = historyOf(*tables, scratch);
+	std::vector<size_t> positions(count);
+	index.floorSorted(&days[0], count, &positions[0]);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t target = sorted ? i : order[i];
+		Valuation& result = results[target];
+		result.found = (positions[i] != RateIndex::npos);
+		result.rate = result.found ? index.rateAt(positions[i]) : 0.0f;
+		result.value = queries[target].amount * result.rate;
+	}
+	return results;
+}
+
+/**
+ * Values columns of (date, amount) queries, block by block.
+ *
+ * Each block first resolves its dates to rows of the index, with a merge walk when the block is
+ * sorted by date (see RateIndex::floorSorted) and interleaved searches otherwise (see
+ * RateIndex::floorBatch), and gathers the
+ * rates into a flat array. The valuation itself is then a branch-free loop over three flat
+ * arrays, which the compiler can vectorize. Rates come from the exact fixed-point column of the
+ * index, so a float64 amount is multiplied by the correctly rounded double of the CSV rate.
+ *
+ * Amounts are checked like text amounts: negative ones, ones above 1000 and NaN get an error
+ * status and a value of 0.
+ *
+ * @param days The queried dates, as days since 1970-01-01.
+ * @param amounts The amounts.
+ * @param count The number of queries.
+ * @param status Receives one ColumnFile::Status per query.
+ * @param values Receives the value of each query.
+ */
+void BitCoinExchange::valueColumns(const int32_t* days, const double* amounts, size_t count, int32_t* status,
+	double* values) const {
+	uint32_t dayNumbers[COLUMN_BLOCK];
+	size_t positions[COLUMN_BLOCK];
+	double rates[COLUMN_BLOCK];
+	int32_t found[COLUMN_BLOCK];
+
+	RcuPointer<Tables>::ReadGuard tables(_tables);
+	RateIndex scratch;
+	const RateIndex& index = historyOf(*tables, scratch);
+	for (size_t start = 0; start < count; start += COLUMN_BLOCK)
+	{
+		size_t block = (count - start < COLUMN_BLOCK) ? count - start : COLUMN_BLOCK;
+		bool sorted = true;
+		bool representable = true;
+		for (size_t i = 0; i < block; i++)
+		{
+			if (!ColumnFile::fromEpochDay(days[start + i], dayNumbers[i]))
+			{
+				dayNumbers[i] = 0;
+				representable = false;
+			}
+			sorted = sorted && (i == 0 || days[start + i - 1] <= days[start + i]);
+		}
+
+		if (sorted && representable)
+			index.floorSorted(dayNumbers, block, positions);
+		else
+		{
+			index.floorBatch(dayNumbers, block, positions);
+			for (size_t i = 0; i < block && !representable; i++)
+			{
+				uint32_t day;
+				if (!ColumnFile::fromEpochDay(days[start + i], day))
+					positions[i] = RateIndex::npos;
+			}
+		}
+
+		for (size_t i = 0; i < block; i++)
+		{
+			found[i] = (positions[i] != RateIndex::npos);
+			int64_t fixedRate = found[i] ? index.fixedRateAt(positions[i]) : 0;
+			if (fixedRate == RateIndex::INEXACT_RATE)
+				rates[i] = index.rateAt(positions[i]);
+			else
+				rates[i] = static_cast<double>(fixedRate) / static_cast<double>(RateIndex::FIXED_UNIT);
+		}
+
+		const double* amount = amounts + start;
+		int32_t* state = status + start;
+		double* value = values + start;
+		for (size_t i = 0; i < block; i++)
+		{
+			double a = amount[i];
+			int32_t code = !found[i] ? ColumnFile::STATUS_NO_RATE
+				: a < 0 ? ColumnFile::STATUS_NEGATIVE
+				: a > 1000 ? ColumnFile::STATUS_TOO_LARGE
+				: a != a ? ColumnFile::STATUS_BAD_INPUT
+				: ColumnFile::STATUS_OK;
+			state[i] = code;
+			value[i] = code == ColumnFile::STATUS_OK ? a * rates[i] : 0.0;
+		}
+	}
+}
+
+/**
+ * Trims spaces and tabs from both ends of a character range, like the trim performed in
+ * processInputFile.
+ */
+static void trimRange(const char*& begin, const char*& end)
+{
+	while (begin < end && (*begin == ' ' || *begin == '\t'))
+		++begin;
+	while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+		--end;
+}
+
+/**
+ * Validates an amount given as a character range.
+ *
+ * Mirrors isValidValue without building a stream: the number must parse completely (trailing
+ * whitespace is allowed), be positive and not exceed 1000. Nothing is printed; the caller maps
+ * the returned status to the matching error message.
+ *
+ * @param begin The first character of the trimmed amount.
+ * @param end One past the last character of the trimmed amount.
+ * @param value Receives the parsed amount.
+ * @return VALUE_OK, or the reason the amount was rejected.
+ */
+BitCoinExchange::ValueStatus BitCoinExchange::checkValue(const char* begin, const char* end, float& value) const {
+	const char* p = Decimal::parseFloat(begin, end, value);
+	if (!p)
+		return VALUE_BAD_INPUT;
+	while (p < end && std::isspace(static_cast<unsigned char>(*p)))
+		++p;
+	if (p != end)
+		return VALUE_BAD_INPUT;
+	if (value < 0)
+		return VALUE_NEGATIVE;
+	if (value > 1000)
+		return VALUE_TOO_LARGE;
+	return VALUE_OK;
+}
+
+/**
+ * Values a single "date | value" line and appends the result or error message to the output.
+ *
+ * The line is handled as slices of the input buffer, so nothing is allocated. The text written
+ * is byte for byte what processInputFile prints for the same line.
+ *
+ * @param begin The first character of the line.
+ * @param end One past the last character of the line, excluding the newline.
+ * @param out The buffer receiving the output line.
+ * @param tables The lookup tables pinned by the caller.
+ * @param cache The date cache, bound to the tables by the caller, or NULL.
+ * @param asset The asset to value the line with, or NULL for the bitcoin rate database.
+ */
+void BitCoinExchange::valueLine(const char* begin, const char* end, OutputBuffer& out, const Tables& tables,
+	DateCache* cache, const AssetRef* asset) const {
+	BTC_STATS_TIMER(split, STAGE_SPLIT);
+	const char* bar = static_cast<const char*>(std::memchr(begin, '|', end - begin));
+	if (!bar)
+	{
+		BTC_STATS_STOP(split);
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: bad input => ", begin, end - begin);
+		return;
+	}
+
+	const char* dateBegin = begin;
+	const char* dateEnd = bar;
+	const char* valueBegin = bar + 1;
+	const char* valueEnd = end;
+	trimRange(dateBegin, dateEnd);
+	trimRange(valueBegin, valueEnd);
+	BTC_STATS_STOP(split);
+
+	uint32_t day;
+	DateCache::Entry* entry = cache ? cache->lookup(dateBegin, dateEnd - dateBegin) : NULL;
+	BTC_STATS_TIMER(dateTimer, STAGE_DATE);
+	bool validDate = cachedDate(entry, dateBegin, dateEnd - dateBegin, day);
+	BTC_STATS_STOP(dateTimer);
+	if (!validDate)
+	{
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: bad input => ", dateBegin, dateEnd - dateBegin);
+		return;
+	}
+
+	float value;
+	BTC_STATS_TIMER(valueTimer, STAGE_VALUE);
+	ValueStatus status = checkValue(valueBegin, valueEnd, value);
+	BTC_STATS_STOP(valueTimer);
+	switch (status)
+	{
+		case VALUE_OK:
+			break;
+		case VALUE_BAD_INPUT:
+			BTC_STATS_COUNT(LINES_BAD_INPUT);
+			appendError(out, "Error: bad input => ", valueBegin, valueEnd - valueBegin);
+			return;
+		case VALUE_NEGATIVE:
+			BTC_STATS_COUNT(LINES_NEGATIVE);
+			appendError(out, "Error: not a positive number.");
+			return;
+		case VALUE_TOO_LARGE:
+			BTC_STATS_COUNT(LINES_TOO_LARGE);
+			appendError(out, "Error: too large a number.");
+			return;
+	}
+
+	float rate = 0;
+	int64_t fixedRate = 0;
+	BTC_STATS_TIMER(lookup, STAGE_LOOKUP);
+	bool found;
+	if (asset)
+		found = findAssetRate(tables.assets, asset->id, day, rate, fixedRate);
+	else if (entry && entry->state >= DateCache::NO_RATE)
+	{
+		found = (entry->state == DateCache::FOUND);
+		rate = entry->rate;
+		fixedRate = entry->fixedRate;
+	}
+	else
+	{
+		found = _exact ? findFixedRate(tables, day, fixedRate) : findRate(tables, day, rate);
+		if (entry)
+		{
+			entry->state = found ? DateCache::FOUND : DateCache::NO_RATE;
+			entry->rate = rate;
+			entry->fixedRate = fixedRate;
+		}
+	}
+	BTC_STATS_STOP(lookup);
+	if (!found)
+	{
+		BTC_STATS_COUNT(LINES_NO_RATE);
+		appendError(out, "Error: no data available for this date or before.");
+		return;
+	}
+	BTC_STATS_TIMER(output, STAGE_OUTPUT);
+	char number[64];
+	size_t len;
+	if (_exact)
+		len = formatExact(valueBegin, valueEnd, fixedRate, number);
+	else
+		len = Decimal::formatFloat(value * rate, 2, number);
+	if (len == 0)
+	{
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: too many decimals for an exact value.");
+		return;
+	}
+	BTC_STATS_COUNT(LINES_VALID);
+	BTC_STATS_ONLY(if (!asset) countLookup(tables, day));
+	appendResult(out, dateBegin, dateEnd - dateBegin, valueBegin, valueEnd - valueBegin, number, len, asset);
+}
+
+/**
+ * Values a single "asset | date | value" line and appends the result or error message to the
+ * output.
+ *
+ * The asset is looked up in the asset store, then the rest of the line is valued like a
+ * "date | value" line against the history of that asset.
+ *
+ * @param begin The first character of the line.
+ * @param end One past the last character of the line, excluding the newline.
+ * @param out The buffer receiving the output line.
+ * @param tables The lookup tables pinned by the caller.
+ */
+void BitCoinExchange::valueAssetLine(const char* begin, const char* end, OutputBuffer& out,
+	const Tables& tables) const {
+	const char* bar = static_cast<const char*>(std::memchr(begin, '|', end - begin));
+	if (!bar || !std::memchr(bar + 1, '|', end - bar - 1))
+	{
+		BTC_STATS_COUNT(LINES_BAD_INPUT);
+		appendError(out, "Error: bad input => ", begin, end - begin);
+		return;
+	}
+
+	const char* nameBegin = begin;
+	const char* nameEnd = bar;
+	trimRange(nameBegin, nameEnd);
+	AssetRef asset;
+	asset.id = tables.assets.find(nameBegin, nameEnd - nameBegin);
+	asset.name = nameBegin;
+	asset.len = nameEnd - nameBegin;
+	if (asset.id == AssetStore::npos)
+	{
+		BTC_STATS_COUNT(LINES_NO_RATE);
+		appendError(out, "Error: unknown asset => ", nameBegin, nameEnd - nameBegin);
+		return;
+	}
+	valueLine(bar + 1, end, out, tables, NULL, &asset);
+}
+
+/**
+ * Appends an error line, in red when colors are enabled.
+ *
+ * @param out The buffer receiving the line.
+ * @param message The error message.
+ * @param text Optional text printed after the message (the offending input), or NULL.
+ * @param len The length of the text.
+ */
+void BitCoinExchange::appendError(OutputBuffer& out, const char* message, const char* text, size_t len) const {
+	if (_colors)
+		out.append(BRED);
+	out.append(message);
+	if (text)
+		out.append(text, len);
+	if (_colors)
+		out.append(RESET);
+	out.append('\n');
+}
+
+/**
+ * Appends a result line "date => value = result", in green when colors are enabled.
+ *
+ * @param out The buffer receiving the line.
+ * @param date The date as written in the input.
+ * @param dateLen The length of the date.
+ * @param value The amount as written in the input.
+ * @param valueLen The length of the amount.
+ * @param result The formatted result.
+ * @param resultLen The length of the result.
+ * @param asset The asset printed before the date, as "asset | ", or NULL.
+ */
+void BitCoinExchange::appendResult(OutputBuffer& out, const char* date, size_t dateLen, const char* value,
+	size_t valueLen, const char* result, size_t resultLen, const AssetRef* asset) const {
+	if (_colors)
+		out.append(BGRN);
+	if (asset)
+	{
+		out.append(asset->name, asset->len);
+		out.append(" | ");
+	}
+	out.append(date, dateLen);
+	out.append(" => ");
+	out.append(value, valueLen);
+	out.append(" = ");
+	out.append(result, resultLen);
+	if (_colors)
+		out.append(RESET);
+	out.append('\n');
+}
+
+/**
+ * Values every line of a range of the input and appends the results to the output.
+ *
+ * The lookup tables are pinned for blocks of lines rather than for the whole range, so that a
+ * database reload running meanwhile can free the previous tables soon after publishing.
+ *
+ * @param begin The first character of the range, at the start of a line.
+ * @param end One past the last character of the range.
+ * @param out The buffer receiving the output.
+ * @param cache The date cache of the calling thread, or NULL to resolve every line.
+ */
+void BitCoinExchange::valueRange(const char* begin, const char* end, OutputBuffer& out, DateCache* cache) const {
+	const size_t blockLines = 4096;
+	const char* p = begin;
+	while (p < end)
+	{
+		RcuPointer<Tables>::ReadGuard tables(_tables);
+		if (cache)
+			cache->bind(tables->version);
+		for (size_t n = 0; n < blockLines && p < end; n++)
+		{
+			const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (!eol) eol = end;
+			valueLine(p, eol, out, *tables, cache);
+			p = (eol < end) ? eol + 1 : end;
+		}
+	}
+}
+
+/**
+ * Shared state of a multi-threaded valuation.
+ *
+ * The input is cut into chunks at line boundaries. Workers claim chunks in order and format each
+ * one into its own memory buffer; the calling thread writes finished chunks in their original
+ * order. Workers never run more than `window` chunks ahead of the writer, which bounds the
+ * memory held by pending output.
+ */
+struct ParallelJob
+{
+	const BitCoinExchange* exchange;
+	std::vector<const char*> bounds;
+	std::vector<std::vector<char> > outputs;
+	std::vector<char> done;
+	size_t next;
+	size_t written;
+	size_t window;
+	bool failed;
+	pthread_mutex_t mutex;
+	pthread_cond_t ready;
+	pthread_cond_t room;
+};
+
+/**
+ * Worker thread body: claims chunks, values them and marks them as done.
+ *
+ * @param arg The ParallelJob shared by all workers.
+ * @return Always NULL.
+ */
+void* BitCoinExchange::valueChunks(void* arg) {
+	ParallelJob* job = static_cast<ParallelJob*>(arg);
+	size_t count = job->outputs.size();
+	DateCache cache;
+	DateCache* memo = job->exchange->_useCache ? &cache : NULL;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&job->mutex);
+		while (!job->failed && job->next < count && job->next >= job->written + job->window)
+			pthread_cond_wait(&job->room, &job->mutex);
+		if (job->failed || job->next >= count)
+		{
+			pthread_mutex_unlock(&job->mutex);
+			break;
+		}
+		size_t i = job->next++;
+		pthread_mutex_unlock(&job->mutex);
+
+		bool ok = true;
+		try {
+			OutputBuffer out(job->outputs[i]);
+			job->exchange->valueRange(job->bounds[i], job->bounds[i + 1], out, memo);
+			out.flush();
+		} catch (const std::exception&) {
+			ok = false;
+		}
+
+		pthread_mutex_lock(&job->mutex);
+		if (ok)
+			job->done[i] = 1;
+		else
+			job->failed = true;
+		pthread_cond_broadcast(&job->ready);
+		pthread_cond_broadcast(&job->room);
+		pthread_mutex_unlock(&job->mutex);
+		if (!ok)
+			break;
+	}
+	return NULL;
+}
+
+/**
+ * Values a range of whole lines with several threads, keeping the output in input order.
+ *
+ * @param begin The first character of the range, at the start of a line.
+ * @param end One past the last character of the range.
+ * @param out The buffer receiving the output.
+ * @param threads The number of worker threads to start.
+ * @throw std::runtime_error if a worker fails or the output cannot be written.
+ */
+void BitCoinExchange::valueParallel(const char* begin, const char* end, OutputBuffer& out, size_t threads) const {
+	const size_t minChunk = 1 << 16;
+	const size_t maxChunk = 1 << 23;
+	size_t chunkSize = static_cast<size_t>(end - begin) / (threads * 4);
+	chunkSize = std::max(minChunk, std::min(maxChunk, chunkSize));
+
+	ParallelJob job;
+	job.exchange = this;
+	job.bounds.push_back(begin);
+	while (job.bounds.back() < end)
+	{
+		const char* cut = job.bounds.back() + std::min(chunkSize, static_cast<size_t>(end - job.bounds.back()));
+		if (cut < end)
+		{
+			const char* eol = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+			cut = eol ? eol + 1 : end;
+		}
+		job.bounds.push_back(cut);
+	}
+
+	size_t count = job.bounds.size() - 1;
+	job.outputs.resize(count);
+	job.done.assign(count, 0);
+	job.next = 0;
+	job.written = 0;
+	job.window = threads * 4;
+	job.failed = false;
+	pthread_mutex_init(&job.mutex, NULL);
+	pthread_cond_init(&job.ready, NULL);
+	pthread_cond_init(&job.room, NULL);
+
+	std::vector<pthread_t> workers;
+	for (size_t t = 0; t < threads && t < count; t++)
+	{
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, &BitCoinExchange::valueChunks, &job) == 0)
+			workers.push_back(tid);
+	}
+
+	bool failed = false;
+	if (workers.empty())
+	{
+		job.failed = true;
+		valueRange(begin, end, out);
+	}
+	else
+	{
+		try {
+			for (size_t i = 0; i < count; i++)
+			{
+				pthread_mutex_lock(&job.mutex);
+				while (!job.done[i] && !job.failed)
+					pthread_cond_wait(&job.ready, &job.mutex);
+				failed = job.failed;
+				pthread_mutex_unlock(&job.mutex);
+				if (failed)
+					break;
+
+				if (!job.outputs[i].empty())
+					out.append(&job.outputs[i][0], job.outputs[i].size());
+				std::vector<char>().swap(job.outputs[i]);
+
+				pthread_mutex_lock(&job.mutex);
+				job.written++;
+				pthread_cond_broadcast(&job.room);
+				pthread_mutex_unlock(&job.mutex);
+			}
+		} catch (const std::exception&) {
+			failed = true;
+		}
+		pthread_mutex_lock(&job.mutex);
+		if (failed)
+			job.failed = true;
+		pthread_cond_broadcast(&job.room);
+		pthread_mutex_unlock(&job.mutex);
+	}
+
+	for (size_t t = 0; t < workers.size(); t++)
+		pthread_join(workers[t], NULL);
+	pthread_cond_destroy(&job.room);
+	pthread_cond_destroy(&job.ready);
+	pthread_mutex_destroy(&job.mutex);
+
+	if (failed)
+		throw std::runtime_error("could not value input in parallel.");
+}
+
+/**
+ * Processes a file of "date | value" lines in streaming mode.
+ *
+ * Produces the same output as processInputFile, but the file is memory mapped and every line is
+ * parsed as slices of the mapping, without std::string temporaries or streams. Results are
+ * collected in a block-buffered writer instead of being flushed line by line.
+ *
+ * With more than one thread, the lines are split into chunks at newline boundaries and valued in
+ * parallel against the shared read-only rate index; results, error lines included, are still
+ * written in the original line order.
+ *
+ * @param filename The name of the file to process.
+ * @param out The buffer receiving the output.
+ * @param threads The number of threads to use; 0 or 1 values the file on the calling thread.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::streamInputFile(const std::string& filename, OutputBuffer& out, size_t threads) const {
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		throw std::runtime_error("could not open file.");
+	}
+
+	const char* p = file.data();
+	const char* end = p + file.size();
+
+	const char* eol = p ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : NULL;
+	p = eol ? eol + 1 : end; // Skip header
+
+	DateCache cache;
+	if (threads > 1 && p < end)
+		valueParallel(p, end, out, threads);
+	else
+		valueRange(p, end, out, _useCache ? &cache : NULL);
+	out.flush();
+}
+
+/**
+ * Values a column file of queries and writes the matching column file of results.
+ *
+ * @param input The query file (see ColumnFile).
+ * @param output The result file to create or replace.
+ * @return The number of queries valued.
+ * @throw std::runtime_error if the query file cannot be read or the result file written.
+ */
+size_t BitCoinExchange::valueColumnFile(const std::string& input, const std::string& output) const {
+	MappedFile file;
+	const int32_t* days;
+	const double* amounts;
+	size_t count;
+	if (!ColumnFile::map(input, ColumnFile::QUERIES, file, days, amounts, count))
+	{
+		throw std::runtime_error("could not read column file.");
+	}
+
+	std::vector<int32_t> status(count);
+	std::vector<double> values(count);
+	if (count > 0)
+		valueColumns(days, amounts, count, &status[0], &values[0]);
+	if (!ColumnFile::write(output, ColumnFile::RESULTS, count ? &status[0] : NULL, count ? &values[0] : NULL, count))
+	{
+		throw std::runtime_error("could not write column file.");
+	}
+	return count;
+}
+
+/**
+ * Converts a "date | value" text input file into a column file of queries.
+ *
+ * Lines whose date is invalid or whose amount is rejected as bad input by checkValue, the
+ * check the text path uses, cannot be represented in the columns and are skipped; amounts out
+ * of range are kept, so that valuing the columns reports them like the text path does. The
+ * amount is checked as a float, but stored as the double parsed from the same text, so the
+ * column keeps its full precision.
+ *
+ * @param input The text input file, with a header line.
+ * @param output The column file to create or replace.
+ * @param skipped Receives the number of lines skipped.
+ * @return The number of rows written.
+ * @throw std::runtime_error if the input cannot be opened or the output written.
+ */
+size_t BitCoinExchange::convertInputFile(const std::string& input, const std::string& output, size_t& skipped) const {
+	MappedFile file;
+	if (!file.open(input))
+	{
+		throw std::runtime_error("could not open file.");
+	}
+
+	std::vector<int32_t> days;
+	std::vector<double> amounts;
+	skipped = 0;
+	const char* p = file.data();
+	const char* end = p + file.size();
+	const char* eol = p ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : NULL;
+	p = eol ? eol + 1 : end; // Skip header
+
+	while (p < end)
+	{
+		eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		const char* lineEnd = eol ? eol : end;
+		const char* bar = static_cast<const char*>(std::memchr(p, '|', lineEnd - p));
+		const char* dateBegin = p;
+		const char* dateEnd = bar ? bar : lineEnd;
+		const char* valueBegin = bar ? bar + 1 : lineEnd;
+		const char* valueEnd = lineEnd;
+		p = eol ? eol + 1 : end;
+		if (!bar && dateBegin == dateEnd)
+			continue;
+		trimRange(dateBegin, dateEnd);
+		trimRange(valueBegin, valueEnd);
+
+		uint32_t day;
+		float checked;
+		if (!bar || !Date::parse(dateBegin, dateEnd - dateBegin, day)
+			|| checkValue(valueBegin, valueEnd, checked) == VALUE_BAD_INPUT)
+		{
+			++skipped;
+			continue;
+		}
+		std::string amount(valueBegin, valueEnd);
+		days.push_back(ColumnFile::toEpochDay(day));
+		amounts.push_back(std::strtod(amount.c_str(), NULL));
+	}
+
+	size_t count = days.size();
+	if (!ColumnFile::write(output, ColumnFile::QUERIES, count ? &days[0] : NULL, count ? &amounts[0] : NULL, count))
+	{
+		throw std::runtime_error("could not write column file.");
+	}
+	return count;
+}
+
+/**
+ * Values a file of "asset | date | value" lines against the asset store.
+ *
+ * The input is mapped and handled like streamInputFile does, one block of lines per read-side
+ * section. Results are printed as "asset | date => value = result".
+ *
+ * @param filename The name of the input file, with a header line.
+ * @param out The buffer receiving the output.
+ * @throw std::runtime_error if the file cannot be opened.
+ */
+void BitCoinExchange::processAssetFile(const std::string& filename, OutputBuffer& out) const {
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		throw std::runtime_error("could not open file.");
+	}
+
+	const size_t blockLines = 4096;
+	const char* p = file.data();
+	const char* end = p + file.size();
+	const char* eol = p ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : NULL;
+	p = eol ? eol + 1 : end; // Skip header
+
+	while (p < end)
+	{
+		RcuPointer<Tables>::ReadGuard tables(_tables);
+		for (size_t n = 0; n < blockLines && p < end; n++)
+		{
+			eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (!eol) eol = end;
+			valueAssetLine(p, eol, out, *tables);
+			p = (eol < end) ? eol + 1 : end;
 		}
 	}
+	out.flush();
 }
@@ -0,0 +1,153 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ColumnFile.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/08 10:14:37 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/08 10:14:37 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ColumnFile.hpp"
+#include "../inc/OutputBuffer.hpp"
+#include "../inc/Date.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char g_magic[8] = { 'B', 'T', 'C', 'C', 'O', 'L', 'S', '\0' };
+
+/**
+ * @return The day number of 1970-01-01, the origin of epoch days.
+ */
+static uint32_t epochOrigin()
+{
+	static const uint32_t origin = Date::toDayNumber(1970, 1, 1);
+	return origin;
+}
+
+/**
+ * @param count The number of rows.
+ * @return The byte offset of the float64 column: the int32 column padded to 8 bytes.
+ */
+size_t ColumnFile::valuesOffset(size_t count)
+{
+	return sizeof(Header) + (count * sizeof(int32_t) + 7) / 8 * 8;
+}
+
+/**
+ * @param dayNumber A day number (see Date::toDayNumber).
+ * @return The number of days between 1970-01-01 and that day, negative before 1970.
+ */
+int32_t ColumnFile::toEpochDay(uint32_t dayNumber)
+{
+	return static_cast<int32_t>(static_cast<int64_t>(dayNumber) - epochOrigin());
+}
+
+/**
+ * @param epochDay A number of days since 1970-01-01.
+ * @param dayNumber Receives the matching day number.
+ * @return false if the day is too far in the past to have a day number.
+ */
+bool ColumnFile::fromEpochDay(int32_t epochDay, uint32_t& dayNumber)
+{
+	int64_t day = static_cast<int64_t>(epochDay) + epochOrigin();
+	if (day < 0)
+		return false;
+	dayNumber = static_cast<uint32_t>(day);
+	return true;
+}
+
+/**
+ * Writes a column file.
+ *
+ * Like a snapshot, the file is written to a temporary name and renamed over
+ * the target, so readers never see a partial file.
+ *
+ * @param filename The file to create or replace.
+ * @param kind What the columns hold.
+ * @param keys The int32 column.
+ * @param values The float64 column.
+ * @param count The number of rows.
+ * @return true on success, false if the file could not be written.
+ */
+bool ColumnFile::write(const std::string& filename, Kind kind, const int32_t* keys, const double* values, size_t count)
+{
+	std::ostringstream tmp;
+	tmp << filename << ".tmp." << getpid();
+	std::string tmpName = tmp.str();
+
+	int fd = ::open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, g_magic, sizeof(g_magic));
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.kind = kind;
+	header.count = count;
+
+	static const char padding[8] = { 0 };
+	bool ok = true;
+	try {
+		OutputBuffer out(fd);
+		out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (count > 0)
+		{
+			out.append(reinterpret_cast<const char*>(keys), count * sizeof(int32_t));
+			out.append(padding, valuesOffset(count) - sizeof(Header) - count * sizeof(int32_t));
+			out.append(reinterpret_cast<const char*>(values), count * sizeof(double));
+		}
+		out.flush();
+	} catch (const std::exception&) {
+		ok = false;
+	}
+
+	if (::close(fd) < 0)
+		ok = false;
+	if (ok && std::rename(tmpName.c_str(), filename.c_str()) != 0)
+		ok = false;
+	if (!ok)
+		std::remove(tmpName.c_str());
+	return ok;
+}
+
+/**
+ * Maps a column file and points at its columns in place.
+ *
+ * @param filename The column file.
+ * @param kind The kind of file expected.
+ * @param file Receives the mapping, which must outlive the column pointers.
+ * @param keys Receives the int32 column.
+ * @param values Receives the float64 column.
+ * @param count Receives the number of rows.
+ * @return true on success, false if the file is missing, of another kind, or malformed.
+ */
+bool ColumnFile::map(const std::string& filename, Kind kind, MappedFile& file, const int32_t*& keys,
+	const double*& values, size_t& count)
+{
+	if (!file.open(filename) || file.size() < sizeof(Header))
+		return false;
+
+	Header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, g_magic, sizeof(g_magic)) != 0
+		|| header.version != VERSION
+		|| header.byteOrder != BYTE_ORDER_MARK
+		|| header.kind != static_cast<uint32_t>(kind)
+		|| header.count > file.size()
+		|| valuesOffset(static_cast<size_t>(header.count)) + header.count * sizeof(double) != file.size())
+		return false;
+
+	count = static_cast<size_t>(header.count);
+	keys = reinterpret_cast<const int32_t*>(file.data() + sizeof(Header));
+	values = reinterpret_cast<const double*>(file.data() + valuesOffset(count));
+	return true;
+}
@@ -0,0 +1,397 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CompressedIndex.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/15 11:06:44 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/15 11:06:44 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/CompressedIndex.hpp"
+#include <algorithm>
+#include <cstring>
+
+static uint32_t floatBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/**
+ * Computes the float rate implied by a fixed-point rate. For rates written with at most
+ * RateIndex::FIXED_SCALE decimals, this is nearly always the float parsed from the CSV text.
+ */
+static float derivedRate(int64_t fixedRate)
+{
+	return static_cast<float>(static_cast<double>(fixedRate) / static_cast<double>(RateIndex::FIXED_UNIT));
+}
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty index.
+ */
+CompressedIndex::CompressedIndex() : _bitCount(0), _count(0) {}
+
+/**
+ * Copy constructor
+ *
+ * @param other The index to copy from.
+ */
+CompressedIndex::CompressedIndex(const CompressedIndex& other)
+	: _firstDays(other._firstDays), _blocks(other._blocks), _bits(other._bits), _bitCount(other._bitCount),
+	_count(other._count) {}
+
+/**
+ * Destructor
+ */
+CompressedIndex::~CompressedIndex() {}
+
+/**
+ * Assignment operator
+ *
+ * @param other The index to assign from.
+ * @return A reference to this index.
+ */
+CompressedIndex& CompressedIndex::operator=(const CompressedIndex& other)
+{
+	if (this != &other)
+	{
+		_firstDays = other._firstDays;
+		_blocks = other._blocks;
+		_bits = other._bits;
+		_bitCount = other._bitCount;
+		_count = other._count;
+	}
+	return *this;
+}
+
+/**
+ * Compresses the rows of a frozen rate index, replacing the content of this one.
+ *
+ * @param index The index to compress.
+ */
+void CompressedIndex::build(const RateIndex& index)
+{
+	clear();
+	_count = index.size();
+	if (_count == 0)
+		return;
+
+	size_t blockCount = (_count + BLOCK_ROWS - 1) / BLOCK_ROWS;
+	_firstDays.reserve(blockCount);
+	_blocks.reserve(blockCount);
+	for (size_t first = 0; first < _count; first += BLOCK_ROWS)
+	{
+		size_t end = first + rowsIn(first / BLOCK_ROWS);
+		int64_t lowest = index.fixedRateAt(first);
+		int64_t highest = lowest;
+		bool derived = true;
+		for (size_t i = first + 1; i < end; i++)
+		{
+			lowest = std::min(lowest, index.fixedRateAt(i));
+			highest = std::max(highest, index.fixedRateAt(i));
+			derived = derived && floatBits(derivedRate(index.fixedRateAt(i))) == floatBits(index.rateAt(i));
+		}
+
+		Block block;
+		block.fixedRate = lowest;
+		block.bits = _bitCount;
+		block.rate = index.rateAt(first);
+		block.dayWidth = static_cast<uint8_t>(widthOf(index.dayAt(end - 1) - index.dayAt(first)));
+		block.rateWidth = static_cast<uint8_t>(widthOf(static_cast<uint64_t>(highest) - static_cast<uint64_t>(lowest)));
+		block.derived = derived;
+		_firstDays.push_back(index.dayAt(first));
+		_blocks.push_back(block);
+
+		for (size_t i = first; i < end; i++)
+			writeBits(index.dayAt(i) - index.dayAt(first), block.dayWidth);
+		for (size_t i = first; i < end; i++)
+			writeBits(static_cast<uint64_t>(index.fixedRateAt(i)) - static_cast<uint64_t>(lowest), block.rateWidth);
+		if (derived)
+			continue;
+		FloatState state;
+		state.previous = floatBits(block.rate);
+		state.leading = 32;
+		state.trailing = 32;
+		for (size_t i = first + 1; i < end; i++)
+			writeFloat(state, index.rateAt(i));
+	}
+
+	// readBits loads 8 bytes at a time
+	_bits.resize(_bits.size() + 8, 0);
+	std::vector<uint8_t>(_bits).swap(_bits);
+}
+
+/**
+ * Empties the index.
+ */
+void CompressedIndex::clear()
+{
+	std::vector<uint32_t>().swap(_firstDays);
+	std::vector<Block>().swap(_blocks);
+	std::vector<uint8_t>().swap(_bits);
+	_bitCount = 0;
+	_count = 0;
+}
+
+/**
+ * @return true if the index holds no row.
+ */
+bool CompressedIndex::empty() const
+{
+	return _count == 0;
+}
+
+/**
+ * @return The number of rows.
+ */
+size_t CompressedIndex::size() const
+{
+	return _count;
+}
+
+/**
+ * @return The number of blocks.
+ */
+size_t CompressedIndex::blocks() const
+{
+	return _blocks.size();
+}
+
+/**
+ * @return The number of bytes held by the index and its stream.
+ */
+size_t CompressedIndex::memoryUsage() const
+{
+	return sizeof(*this) + _firstDays.capacity() * sizeof(uint32_t) + _blocks.capacity() * sizeof(Block)
+		+ _bits.capacity();
+}
+
+/**
+ * Finds the row holding the given date or, failing that, the closest earlier date.
+ *
+ * The block is found with a search over the first days of the blocks, and the row with a
+ * branchless binary search over the packed days of the block. Its fixed-point rate is then a
+ * single read; its float rate is computed from it, or decoded from the XOR stream when the block
+ * has one.
+ *
+ * @param day The day number to look up.
+ * @param row Receives the row found.
+ * @return false if every date in the index is later than the requested one.
+ */
+bool CompressedIndex::floor(uint32_t day, Row& row) const
+{
+	size_t block = RateIndex::floorSearch(_firstDays.empty() ? NULL : &_firstDays[0], _firstDays.size(), day);
+	if (block == RateIndex::npos)
+		return false;
+
+	const Block& header = _blocks[block];
+	size_t count = rowsIn(block);
+	uint32_t target = day - _firstDays[block];
+	size_t k = 0;
+	for (size_t len = count; len > 1; len -= len / 2)
+	{
+		size_t mid = k + len / 2;
+		k = (readBits(header.bits + mid * header.dayWidth, header.dayWidth) <= target) ? mid : k;
+	}
+	row.day = _firstDays[block] + static_cast<uint32_t>(readBits(header.bits + k * header.dayWidth, header.dayWidth));
+
+	size_t pos = header.bits + count * header.dayWidth;
+	row.fixedRate = static_cast<int64_t>(static_cast<uint64_t>(header.fixedRate)
+		+ readBits(pos + k * header.rateWidth, header.rateWidth));
+
+	if (k == 0)
+		row.rate = header.rate;
+	else if (header.derived)
+		row.rate = derivedRate(row.fixedRate);
+	else
+	{
+		FloatState state;
+		state.previous = floatBits(header.rate);
+		state.leading = 32;
+		state.trailing = 32;
+		pos += count * header.rateWidth;
+		for (size_t i = 0; i < k; i++)
+			row.rate = readFloat(state, pos);
+	}
+	return true;
+}
+
+/**
+ * Decodes every row of a block.
+ *
+ * @param block The block number, below blocks().
+ * @param rows Receives the rows; BLOCK_ROWS entries are always enough.
+ * @return The number of rows decoded.
+ */
+size_t CompressedIndex::decodeBlock(size_t block, Row* rows) const
+{
+	const Block& header = _blocks[block];
+	size_t count = rowsIn(block);
+	size_t ratePos = header.bits + count * header.dayWidth;
+	size_t floatPos = ratePos + count * header.rateWidth;
+	FloatState state;
+	state.previous = floatBits(header.rate);
+	state.leading = 32;
+	state.trailing = 32;
+	for (size_t i = 0; i < count; i++)
+	{
+		rows[i].day = _firstDays[block] + static_cast<uint32_t>(readBits(header.bits + i * header.dayWidth,
+			header.dayWidth));
+		rows[i].fixedRate = static_cast<int64_t>(static_cast<uint64_t>(header.fixedRate)
+			+ readBits(ratePos + i * header.rateWidth, header.rateWidth));
+		if (i == 0)
+			rows[i].rate = header.rate;
+		else
+			rows[i].rate = header.derived ? derivedRate(rows[i].fixedRate) : readFloat(state, floatPos);
+	}
+	return count;
+}
+
+/**
+ * Decodes every row back into a rate index.
+ *
+ * @param index Receives the rows, frozen on return.
+ */
+void CompressedIndex::decompress(RateIndex& index) const
+{
+	Row rows[BLOCK_ROWS];
+	index.clear();
+	index.reserve(_count);
+	for (size_t b = 0; b < _blocks.size(); b++)
+	{
+		size_t count = decodeBlock(b, rows);
+		for (size_t i = 0; i < count; i++)
+			index.insert(rows[i].day, rows[i].rate, rows[i].fixedRate);
+	}
+	index.freeze();
+}
+
+/**
+ * Appends the low bits of a value to the bit stream, most significant first.
+ *
+ * @param value The bits to write.
+ * @param count The number of bits, 0 to 64.
+ */
+void CompressedIndex::writeBits(uint64_t value, unsigned int count)
+{
+	while (count-- > 0)
+	{
+		if (_bitCount % 8 == 0)
+			_bits.push_back(0);
+		if ((value >> count) & 1)
+			_bits.back() |= static_cast<uint8_t>(0x80 >> (_bitCount % 8));
+		++_bitCount;
+	}
+}
+
+/**
+ * Reads bits from the bit stream. Up to 57 bits are read with a single unaligned 64-bit window.
+ *
+ * @param pos The bit position.
+ * @param count The number of bits, 0 to 64.
+ */
+uint64_t CompressedIndex::readBits(size_t pos, unsigned int count) const
+{
+	if (count == 0)
+		return 0;
+	if (count > 57)
+		return (readBits(pos, count - 32) << 32) | readBits(pos + count - 32, 32);
+
+	uint64_t window;
+	std::memcpy(&window, &_bits[pos >> 3], sizeof(window));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	window = __builtin_bswap64(window);
+#endif
+	return (window << (pos & 7)) >> (64 - count);
+}
+
+/**
+ * Writes a float XORed with the previous one.
+ *
+ * A repeated value costs the bit 0. Otherwise the XOR is written as 1 then either 0 and its
+ * meaningful bits inside the window of the previous XOR, when they fit, or 1, 5 bits of leading
+ * zeros, 5 bits of length minus one and the meaningful bits, which opens a new window.
+ */
+void CompressedIndex::writeFloat(FloatState& state, float rate)
+{
+	uint32_t bits = floatBits(rate);
+	uint32_t xored = bits ^ state.previous;
+	state.previous = bits;
+	if (xored == 0)
+	{
+		writeBits(0, 1);
+		return;
+	}
+
+	unsigned int leading = static_cast<unsigned int>(__builtin_clz(xored));
+	unsigned int trailing = static_cast<unsigned int>(__builtin_ctz(xored));
+	if (leading >= state.leading && trailing >= state.trailing)
+	{
+		writeBits(2, 2);
+		writeBits(xored >> state.trailing, 32 - state.leading - state.trailing);
+		return;
+	}
+	unsigned int length = 32 - leading - trailing;
+	writeBits(3, 2);
+	writeBits(leading, 5);
+	writeBits(length - 1, 5);
+	writeBits(xored >> trailing, length);
+	state.leading = leading;
+	state.trailing = trailing;
+}
+
+/**
+ * Reads a float written by writeFloat.
+ *
+ * @param state The previous float and XOR window of the block.
+ * @param pos The bit position, advanced past the float.
+ */
+float CompressedIndex::readFloat(FloatState& state, size_t& pos) const
+{
+	if (readBits(pos++, 1) == 0)
+		return bitsFloat(state.previous);
+
+	unsigned int length;
+	if (readBits(pos++, 1))
+	{
+		state.leading = static_cast<unsigned int>(readBits(pos, 5));
+		length = static_cast<unsigned int>(readBits(pos + 5, 5)) + 1;
+		state.trailing = 32 - state.leading - length;
+		pos += 10;
+	}
+	else
+		length = 32 - state.leading - state.trailing;
+	state.previous ^= static_cast<uint32_t>(readBits(pos, length)) << state.trailing;
+	pos += length;
+	return bitsFloat(state.previous);
+}
+
+/**
+ * @return The number of rows of a block: BLOCK_ROWS, except for the last block.
+ */
+size_t CompressedIndex::rowsIn(size_t block) const
+{
+	size_t first = block * BLOCK_ROWS;
+	return (_count - first < BLOCK_ROWS) ? _count - first : BLOCK_ROWS;
+}
+
+/**
+ * @return The number of bits needed to write a value.
+ */
+unsigned int CompressedIndex::widthOf(uint64_t value)
+{
+	return value ? 64 - static_cast<unsigned int>(__builtin_clzll(value)) : 0;
+}
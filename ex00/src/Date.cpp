@@ -0,0 +1,203 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Date.cpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/20 10:02:11 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/20 10:02:11 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Date.hpp"
+
+/**
+ * Checks if the given year is a leap year (Gregorian rules).
+ *
+ * @param year The year to check.
+ * @return true if the year is a leap year, false otherwise.
+ */
+bool Date::isLeapYear(int year)
+{
+	if (year % 4 != 0) return false;
+	if (year % 100 != 0) return true;
+	return (year % 400 == 0);
+}
+
+/**
+ * Returns the number of days of the given month, accounting for leap years.
+ *
+ * @param year The year the month belongs to.
+ * @param month The month, from 1 to 12.
+ * @return The number of days in the month.
+ */
+int Date::daysInMonth(int year, int month)
+{
+	if (month == 2)
+		return isLeapYear(year) ? 29 : 28;
+	if (month == 4 || month == 6 || month == 9 || month == 11)
+		return 30;
+	return 31;
+}
+
+/**
+ * Converts a calendar date into its day number.
+ *
+ * The conversion counts days in 400-year eras (146097 days each) starting in
+ * March, so that the leap day falls at the end of the counting year. Years are
+ * shifted by one era to keep every four-digit year positive.
+ *
+ * @param year The year (0 to 9999).
+ * @param month The month (1 to 12).
+ * @param day The day of the month.
+ * @return The day number of the date.
+ */
+uint32_t Date::toDayNumber(int year, int month, int day)
+{
+	uint32_t y = static_cast<uint32_t>(year + 400 - (month <= 2 ? 1 : 0));
+	uint32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * static_cast<uint32_t>(month > 2 ? month - 3 : month + 9) + 2) / 5
+		+ static_cast<uint32_t>(day) - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe;
+}
+
+/**
+ * Converts a day number back into a calendar date.
+ *
+ * This is the exact inverse of Date::toDayNumber.
+ *
+ * @param dayNumber The day number to convert.
+ * @param year Receives the year.
+ * @param month Receives the month.
+ * @param day Receives the day of the month.
+ */
+void Date::fromDayNumber(uint32_t dayNumber, int& year, int& month, int& day)
+{
+	uint32_t era = dayNumber / 146097;
+	uint32_t doe = dayNumber - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+
+	day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+	month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+	year = static_cast<int>(yoe + era * 400) + (month <= 2 ? 1 : 0) - 400;
+}
+
+/**
+ * Days per month, indexed by month number (slot 0 is unused).
+ */
+static const uint8_t g_monthDays[13] = {
+	0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+/**
+ * Loads 8 bytes as a little-endian word, whatever the host byte order.
+ *
+ * Compilers turn this into a single unaligned load on little-endian hosts.
+ */
+static uint64_t load8(const char* str)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+	return static_cast<uint64_t>(p[0]) | static_cast<uint64_t>(p[1]) << 8
+		| static_cast<uint64_t>(p[2]) << 16 | static_cast<uint64_t>(p[3]) << 24
+		| static_cast<uint64_t>(p[4]) << 32 | static_cast<uint64_t>(p[5]) << 40
+		| static_cast<uint64_t>(p[6]) << 48 | static_cast<uint64_t>(p[7]) << 56;
+}
+
+/**
+ * Parses a "YYYY-MM-DD" date and converts it into its day number.
+ *
+ * Implements the rules of BitCoinExchange::isValidDate: exactly ten
+ * characters, hyphens at positions 4 and 7, digits everywhere else, a month
+ * between 1 and 12 and a day that exists in that month.
+ *
+ * The "YYYY-MM-" prefix is checked as one 64-bit word (SWAR): the hyphen bytes
+ * are compared under a mask, then swapped for '0' so that all eight bytes can
+ * be tested as digits at once. A byte is a digit when neither subtracting '0'
+ * nor adding 0x46 sets its high bit. Month lengths come from a lookup table,
+ * with one extra day for February of a leap year.
+ *
+ * @param str Pointer to the first character of the date.
+ * @param len Number of characters of the date.
+ * @param dayNumber Receives the day number if the date is valid.
+ * @return true if the date is valid, false otherwise.
+ */
+bool Date::parse(const char* str, size_t len, uint32_t& dayNumber)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t highBits = 0x8080808080808080ULL;
+	const uint64_t dashMask = 0xFF00000000ULL | 0xFF00000000000000ULL;
+	const uint64_t dashes = 0x2D00000000ULL | 0x2D00000000000000ULL;
+
+	if (len != 10)
+		return false;
+
+	uint64_t chunk = load8(str);
+	uint64_t digits = (chunk & ~dashMask) | (ones * '0' & dashMask);
+	uint64_t bad = ((digits - ones * '0') | (digits + ones * 0x46) | digits) & highBits;
+	unsigned int d8 = static_cast<unsigned char>(str[8]) - '0';
+	unsigned int d9 = static_cast<unsigned char>(str[9]) - '0';
+
+	if ((chunk & dashMask) != dashes || bad != 0 || d8 > 9 || d9 > 9)
+		return false;
+
+	int year = static_cast<int>((chunk & 0xFF) - '0') * 1000
+		+ static_cast<int>((chunk >> 8 & 0xFF) - '0') * 100
+		+ static_cast<int>((chunk >> 16 & 0xFF) - '0') * 10
+		+ static_cast<int>((chunk >> 24 & 0xFF) - '0');
+	unsigned int month = static_cast<unsigned int>((chunk >> 40 & 0xFF) - '0') * 10
+		+ static_cast<unsigned int>((chunk >> 48 & 0xFF) - '0');
+	unsigned int day = d8 * 10 + d9;
+
+	if (month - 1 >= 12)
+		return false;
+	unsigned int limit = g_monthDays[month] + (month == 2 && isLeapYear(year) ? 1 : 0);
+	if (day - 1 >= limit)
+		return false;
+
+	dayNumber = toDayNumber(year, static_cast<int>(month), static_cast<int>(day));
+	return true;
+}
+
+/**
+ * Parses a "YYYY-MM-DD" date string and converts it into its day number.
+ *
+ * @param str The date string.
+ * @param dayNumber Receives the day number if the date is valid.
+ * @return true if the date is valid, false otherwise.
+ */
+bool Date::parse(const std::string& str, uint32_t& dayNumber)
+{
+	return parse(str.data(), str.length(), dayNumber);
+}
+
+/**
+ * Formats a day number as a "YYYY-MM-DD" string.
+ *
+ * @param dayNumber The day number to format.
+ * @return The formatted date.
+ */
+std::string Date::format(uint32_t dayNumber)
+{
+	int year;
+	int month;
+	int day;
+	char buffer[10];
+
+	fromDayNumber(dayNumber, year, month, day);
+	buffer[0] = static_cast<char>('0' + year / 1000 % 10);
+	buffer[1] = static_cast<char>('0' + year / 100 % 10);
+	buffer[2] = static_cast<char>('0' + year / 10 % 10);
+	buffer[3] = static_cast<char>('0' + year % 10);
+	buffer[4] = '-';
+	buffer[5] = static_cast<char>('0' + month / 10);
+	buffer[6] = static_cast<char>('0' + month % 10);
+	buffer[7] = '-';
+	buffer[8] = static_cast<char>('0' + day / 10);
+	buffer[9] = static_cast<char>('0' + day % 10);
+	return std::string(buffer, 10);
+}
@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DateCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/12 09:37:52 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/12 09:37:52 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/DateCache.hpp"
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty cache, bound to no tables.
+ */
+DateCache::DateCache() : _version(0), _hits(0), _misses(0)
+{
+	clear();
+}
+
+/**
+ * Copy constructor
+ *
+ * @param other The cache to copy from.
+ */
+DateCache::DateCache(const DateCache& other)
+	: _version(other._version), _hits(other._hits), _misses(other._misses)
+{
+	std::memcpy(_slots, other._slots, sizeof(_slots));
+}
+
+/**
+ * Destructor
+ */
+DateCache::~DateCache() {}
+
+/**
+ * Assignment operator
+ *
+ * @param other The cache to assign from.
+ * @return A reference to this cache.
+ */
+DateCache& DateCache::operator=(const DateCache& other)
+{
+	if (this != &other)
+	{
+		std::memcpy(_slots, other._slots, sizeof(_slots));
+		_version = other._version;
+		_hits = other._hits;
+		_misses = other._misses;
+	}
+	return *this;
+}
+
+/**
+ * Binds the cache to a version of the lookup tables, emptying it if the
+ * version changed since the last call.
+ *
+ * @param version The version of the tables the next lookups will use.
+ */
+void DateCache::bind(uint64_t version)
+{
+	if (version == _version)
+		return;
+	clear();
+	_version = version;
+}
+
+/**
+ * Empties every slot. The hit and miss counters are kept.
+ */
+void DateCache::clear()
+{
+	std::memset(_slots, 0, sizeof(_slots));
+}
+
+/**
+ * @return The number of lookups that found their date.
+ */
+uint64_t DateCache::hits() const
+{
+	return _hits;
+}
+
+/**
+ * @return The number of lookups that did not find their date.
+ */
+uint64_t DateCache::misses() const
+{
+	return _misses;
+}
@@ -0,0 +1,473 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Decimal.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 10:12:54 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/21 10:12:54 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Decimal.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Powers of ten that are exactly representable as a float.
+ */
+static const float g_pow10[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/**
+ * Checks for the characters std::isspace accepts in the "C" locale.
+ */
+static bool isSpace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Converts an already validated number with strtof.
+ *
+ * Used when the fast path cannot guarantee a correctly rounded result. The
+ * text is copied to a stack buffer so that strtof never reads past the end of
+ * a memory mapped range.
+ */
+static bool slowConvert(const char* begin, const char* end, float& value)
+{
+	char buffer[64];
+	size_t len = static_cast<size_t>(end - begin);
+	char* stop;
+
+	errno = 0;
+	if (len < sizeof(buffer))
+	{
+		std::memcpy(buffer, begin, len);
+		buffer[len] = '\0';
+		value = std::strtof(buffer, &stop);
+	} else
+	{
+		std::string copy(begin, end);
+		value = std::strtof(copy.c_str(), &stop);
+	}
+	// Overflow fails like "istringstream >> float" does, underflow does not.
+	return !(errno == ERANGE && (value > 1.0f || value < -1.0f));
+}
+
+/**
+ * Parses a decimal floating point number from a character range.
+ *
+ * Accepts the same syntax as "std::istringstream >> float" in the "C" locale:
+ * leading whitespace, an optional sign, digits with an optional decimal point
+ * and an optional exponent. Parsing stops at the first character that cannot
+ * extend the number; callers decide what trailing text means.
+ *
+ * Numbers whose digits fit in a float mantissa and with a small exponent are
+ * converted with a single exact float multiplication or division, which is
+ * correctly rounded. Anything else falls back to strtof.
+ *
+ * @param begin The first character of the range.
+ * @param end One past the last character of the range.
+ * @param value Receives the parsed number.
+ * @return A pointer past the last consumed character, or NULL if no number
+ * could be parsed or it overflows a float.
+ */
+const char* Decimal::parseFloat(const char* begin, const char* end, float& value)
+{
+	const char* p = begin;
+	while (p < end && isSpace(*p))
+		++p;
+
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int significant = 0;
+	int exponent = 0;
+
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		if (significant < 19)
+		{
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			if (mantissa) ++significant;
+		} else
+			++exponent;
+		++digits;
+		++p;
+	}
+	if (p < end && *p == '.')
+	{
+		++p;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (significant < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				if (mantissa) ++significant;
+				--exponent;
+			}
+			++digits;
+			++p;
+		}
+	}
+	if (digits == 0)
+		return NULL;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool expNegative = false;
+		if (p < end && (*p == '+' || *p == '-'))
+		{
+			expNegative = (*p == '-');
+			++p;
+		}
+		if (p >= end || *p < '0' || *p > '9')
+			return NULL;
+		int expValue = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (expValue < 100000)
+				expValue = expValue * 10 + (*p - '0');
+			++p;
+		}
+		exponent += expNegative ? -expValue : expValue;
+	}
+
+	if (mantissa < (1u << 24) && exponent >= -10 && exponent <= 10)
+	{
+		float result = static_cast<float>(mantissa);
+		if (exponent < 0)
+			result /= g_pow10[-exponent];
+		else
+			result *= g_pow10[exponent];
+		value = negative ? -result : result;
+		return p;
+	}
+
+	if (!slowConvert(start, p, value))
+		return NULL;
+	return p;
+}
+
+/**
+ * Powers of ten that fit in an int64_t.
+ */
+static const int64_t g_ipow10[] = {
+	1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+	1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+	100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+	1000000000000000000LL
+};
+
+/**
+ * Multiplies or divides by a power of ten, rounding half away from zero when digits are dropped.
+ *
+ * @param value The fixed-point value, whose magnitude is below 10^18.
+ * @param shift The power of ten: positive to multiply, negative to divide.
+ * @param result Receives the rescaled value.
+ * @return true on success, false if the result does not fit in an int64_t.
+ */
+bool Decimal::rescale(int64_t value, int shift, int64_t& result)
+{
+	const int64_t limit = 0x7FFFFFFFFFFFFFFFLL;
+
+	if (value == 0 || shift == 0)
+	{
+		result = value;
+		return true;
+	}
+	if (shift > 0)
+	{
+		if (shift > 18 || (value > 0 ? value : -value) > limit / g_ipow10[shift])
+			return false;
+		result = value * g_ipow10[shift];
+		return true;
+	}
+	if (shift < -18)
+	{
+		result = 0;
+		return true;
+	}
+
+	int64_t divisor = g_ipow10[-shift];
+	int64_t quotient = value / divisor;
+	int64_t remainder = value % divisor;
+	if (remainder < 0)
+		remainder = -remainder;
+	if (remainder >= divisor - remainder)
+		quotient += (value > 0) ? 1 : -1;
+	result = quotient;
+	return true;
+}
+
+/**
+ * Scans a decimal number with the syntax of Decimal::parseFloat into a mantissa of up to 18
+ * significant digits and a power of ten.
+ *
+ * @param begin The first character of the range.
+ * @param end One past the last character of the range.
+ * @param negative Receives whether the number has a minus sign.
+ * @param mantissa Receives the significant digits.
+ * @param exponent Receives the power of ten applied to the mantissa.
+ * @param lost Receives whether a nonzero digit past the 18 significant ones was dropped.
+ * @return A pointer past the last consumed character, or NULL if no number could be parsed.
+ */
+static const char* scanNumber(const char* begin, const char* end, bool& negative, uint64_t& mantissa,
+	int& exponent, bool& lost)
+{
+	const char* p = begin;
+	while (p < end && isSpace(*p))
+		++p;
+
+	negative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	mantissa = 0;
+	exponent = 0;
+	lost = false;
+	int digits = 0;
+	int significant = 0;
+
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		if (significant < 18)
+		{
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			if (mantissa) ++significant;
+		} else
+		{
+			lost = lost || *p != '0';
+			++exponent;
+		}
+		++digits;
+		++p;
+	}
+	if (p < end && *p == '.')
+	{
+		++p;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (significant < 18)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				if (mantissa) ++significant;
+				--exponent;
+			} else
+				lost = lost || *p != '0';
+			++digits;
+			++p;
+		}
+	}
+	if (digits == 0)
+		return NULL;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool expNegative = false;
+		if (p < end && (*p == '+' || *p == '-'))
+		{
+			expNegative = (*p == '-');
+			++p;
+		}
+		if (p >= end || *p < '0' || *p > '9')
+			return NULL;
+		int expValue = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (expValue < 100000)
+				expValue = expValue * 10 + (*p - '0');
+			++p;
+		}
+		exponent += expNegative ? -expValue : expValue;
+	}
+	return p;
+}
+
+/**
+ * Parses a decimal number from a character range as a fixed-point integer.
+ *
+ * Accepts exactly the syntax of Decimal::parseFloat. The result is the number times 10^scale,
+ * rounded half away from zero when the text has more fractional digits than the scale keeps;
+ * only the first 18 significant digits are taken into account.
+ *
+ * @param begin The first character of the range.
+ * @param end One past the last character of the range.
+ * @param scale The number of decimal digits kept (0 to 18).
+ * @param value Receives the scaled number.
+ * @return A pointer past the last consumed character, or NULL if no number could be parsed or
+ * the scaled number does not fit in an int64_t.
+ */
+const char* Decimal::parseFixed(const char* begin, const char* end, int scale, int64_t& value)
+{
+	bool negative;
+	uint64_t mantissa;
+	int exponent;
+	bool lost;
+	const char* p = scanNumber(begin, end, negative, mantissa, exponent, lost);
+	if (!p)
+		return NULL;
+
+	// 18 digits always fit, so only the rescaling can overflow
+	int64_t signedMantissa = static_cast<int64_t>(mantissa);
+	if (!rescale(negative ? -signedMantissa : signedMantissa, exponent + scale, value))
+		return NULL;
+	return p;
+}
+
+/**
+ * Parses a decimal number from a character range at the scale it is written with.
+ *
+ * Accepts exactly the syntax of Decimal::parseFloat. Unlike parseFixed, nothing is rounded: the
+ * number is exactly value / 10^scale, with trailing fractional zeros removed, or the parse
+ * fails.
+ *
+ * @param begin The first character of the range.
+ * @param end One past the last character of the range.
+ * @param value Receives the number times 10^scale.
+ * @param scale Receives the number of decimals needed (0 to 18).
+ * @return A pointer past the last consumed character, or NULL if no number could be parsed or
+ * it cannot be represented exactly: more than 18 significant digits or decimals, or an
+ * integer part that does not fit in an int64_t.
+ */
+const char* Decimal::parseExact(const char* begin, const char* end, int64_t& value, int& scale)
+{
+	bool negative;
+	uint64_t mantissa;
+	int exponent;
+	bool lost;
+	const char* p = scanNumber(begin, end, negative, mantissa, exponent, lost);
+	if (!p || lost)
+		return NULL;
+
+	if (mantissa == 0)
+	{
+		value = 0;
+		scale = 0;
+		return p;
+	}
+	while (exponent < 0 && mantissa % 10 == 0)
+	{
+		mantissa /= 10;
+		++exponent;
+	}
+	int64_t signedMantissa = static_cast<int64_t>(mantissa);
+	if (negative)
+		signedMantissa = -signedMantissa;
+	if (exponent >= 0)
+	{
+		scale = 0;
+		return rescale(signedMantissa, exponent, value) ? p : NULL;
+	}
+	if (exponent < -18)
+		return NULL;
+	scale = -exponent;
+	value = signedMantissa;
+	return p;
+}
+
+/**
+ * Formats a fixed-point integer with the given number of decimals, like printf "%.Nf" would
+ * print the exact decimal value.
+ *
+ * @param value The number times 10^decimals.
+ * @param decimals The number of digits after the decimal point (0 to 18).
+ * @param buffer Receives the text, which is not null-terminated; 24 bytes are always enough.
+ * @return The length of the text.
+ */
+size_t Decimal::formatFixed(int64_t value, int decimals, char* buffer)
+{
+	char digits[24];
+	size_t count = 0;
+	uint64_t magnitude = (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+	do {
+		digits[count++] = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0 || count <= static_cast<size_t>(decimals));
+
+	size_t len = 0;
+	if (value < 0)
+		buffer[len++] = '-';
+	while (count > static_cast<size_t>(decimals))
+		buffer[len++] = digits[--count];
+	if (decimals > 0)
+	{
+		buffer[len++] = '.';
+		while (count > 0)
+			buffer[len++] = digits[--count];
+	}
+	return len;
+}
+
+/**
+ * Formats a float with the given number of decimals, exactly like printf "%.Nf" does.
+ *
+ * A finite float is m * 2^e with m below 2^24, so its value times 10^decimals is an exact
+ * fraction with a power of two as denominator. The quotient and remainder of that fraction give
+ * the digits and the rounding, which is done to nearest with ties to even on the exact binary
+ * value, as glibc does. Values too large for 64-bit arithmetic, infinities and NaN go through
+ * snprintf.
+ *
+ * @param value The number to format.
+ * @param decimals The number of digits after the decimal point (0 to 6).
+ * @param buffer Receives the text, which is not null-terminated; 64 bytes are always enough.
+ * @return The length of the text.
+ */
+size_t Decimal::formatFloat(float value, int decimals, char* buffer)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t biased = bits >> 23 & 0xFF;
+	uint64_t mantissa = bits & 0x7FFFFF;
+	int shift = -149; // |value| = mantissa * 2^shift
+
+	if (biased != 0)
+	{
+		mantissa |= 0x800000;
+		shift = static_cast<int>(biased) - 150;
+	}
+	if (biased == 0xFF || shift > 39 - 4 * decimals)
+	{
+		int len = std::snprintf(buffer, 64, "%.*f", decimals, static_cast<double>(value));
+		return static_cast<size_t>(len);
+	}
+
+	uint64_t scaled = mantissa * static_cast<uint64_t>(g_ipow10[decimals]);
+	if (shift >= 0)
+		scaled <<= shift;
+	else if (-shift > 44)
+		scaled = 0; // below 2^44, so under half of the divisor
+	else
+	{
+		uint64_t remainder = scaled & ((1ULL << -shift) - 1);
+		uint64_t half = 1ULL << (-shift - 1);
+		scaled >>= -shift;
+		if (remainder > half || (remainder == half && (scaled & 1)))
+			++scaled;
+	}
+
+	size_t len = 0;
+	if (bits >> 31)
+		buffer[len++] = '-';
+	return len + formatFixed(static_cast<int64_t>(scaled), decimals, buffer + len);
+}
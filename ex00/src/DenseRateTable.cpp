@@ -0,0 +1,103 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DenseRateTable.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/26 11:34:09 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/26 11:34:09 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/DenseRateTable.hpp"
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty table.
+ */
+DenseRateTable::DenseRateTable() : _firstDay(0) {}
+
+/**
+ * Copy constructor
+ *
+ * @param other The table to copy from.
+ */
+DenseRateTable::DenseRateTable(const DenseRateTable& other)
+	: _firstDay(other._firstDay), _slots(other._slots) {}
+
+/**
+ * Destructor
+ */
+DenseRateTable::~DenseRateTable() {}
+
+/**
+ * Assignment operator
+ *
+ * @param other The table to assign from.
+ * @return A reference to this table.
+ */
+DenseRateTable& DenseRateTable::operator=(const DenseRateTable& other)
+{
+	if (this != &other)
+	{
+		_firstDay = other._firstDay;
+		_slots = other._slots;
+	}
+	return *this;
+}
+
+/**
+ * Fills the table from a frozen rate index.
+ *
+ * @param index The index to expand.
+ * @return true if the table was built, false if the index is empty or spans
+ * more than MAX_DAYS days, in which case the table is left empty.
+ */
+bool DenseRateTable::build(const RateIndex& index)
+{
+	clear();
+	if (index.empty())
+		return false;
+
+	uint32_t first = index.dayAt(0);
+	uint32_t last = index.dayAt(index.size() - 1);
+	if (last - first >= MAX_DAYS)
+		return false;
+
+	_firstDay = first;
+	_slots.resize(last - first + 1);
+	for (size_t i = 0; i < index.size(); i++)
+	{
+		size_t from = index.dayAt(i) - first;
+		size_t to = (i + 1 < index.size()) ? index.dayAt(i + 1) - first : _slots.size();
+		std::fill(_slots.begin() + from, _slots.begin() + to, index.rateAt(i));
+	}
+	return true;
+}
+
+/**
+ * Empties the table.
+ */
+void DenseRateTable::clear()
+{
+	_firstDay = 0;
+	std::vector<float>().swap(_slots);
+}
+
+/**
+ * @return true if the table holds no slots.
+ */
+bool DenseRateTable::empty() const
+{
+	return _slots.empty();
+}
+
+/**
+ * @return The number of day slots in the table.
+ */
+size_t DenseRateTable::size() const
+{
+	return _slots.size();
+}
@@ -0,0 +1,555 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ExchangeServer.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 15:47:22 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/28 15:47:22 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ExchangeServer.hpp"
+#include "../inc/ansi.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static volatile sig_atomic_t g_stop = 0;
+static volatile sig_atomic_t g_reload = 0;
+
+/**
+ * Signal handler asking the event loop to stop.
+ */
+static void requestStop(int)
+{
+	g_stop = 1;
+}
+
+/**
+ * Signal handler asking the event loop to reload the database.
+ */
+static void requestReload(int)
+{
+	g_reload = 1;
+}
+
+/**
+ * Installs the stop and reload handlers (without SA_RESTART, so that blocking
+ * calls are interrupted) and ignores SIGPIPE so that a vanished client only
+ * causes an EPIPE error.
+ */
+static void installSignals()
+{
+	struct sigaction sa;
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = requestStop;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = requestReload;
+	sigaction(SIGHUP, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+	g_stop = 0;
+	g_reload = 0;
+}
+
+/**
+ * Blocks the stop and reload signals while a serve loop runs, and restores the previous mask
+ * when it ends.
+ *
+ * The loop only unblocks them while it waits, through epoll_pwait or ppoll with waiting(). A
+ * signal arriving between the flag checks and the wait stays pending and interrupts the wait
+ * at once, instead of being noticed only when unrelated traffic wakes the loop.
+ */
+class SignalBlock
+{
+	public:
+		SignalBlock()
+		{
+			sigset_t blocked;
+			sigemptyset(&blocked);
+			sigaddset(&blocked, SIGINT);
+			sigaddset(&blocked, SIGTERM);
+			sigaddset(&blocked, SIGHUP);
+			pthread_sigmask(SIG_BLOCK, &blocked, &_saved);
+			_waiting = _saved;
+			sigdelset(&_waiting, SIGINT);
+			sigdelset(&_waiting, SIGTERM);
+			sigdelset(&_waiting, SIGHUP);
+		}
+
+		~SignalBlock()
+		{
+			pthread_sigmask(SIG_SETMASK, &_saved, NULL);
+		}
+
+		/**
+		 * @return The mask to wait with, which lets the stop and reload signals through.
+		 */
+		const sigset_t* waiting() const
+		{
+			return &_waiting;
+		}
+
+	private:
+		sigset_t _saved;
+		sigset_t _waiting;
+
+		SignalBlock(const SignalBlock& other);
+		SignalBlock& operator=(const SignalBlock& other);
+};
+
+/**
+ * Writes a whole buffer to a blocking descriptor.
+ */
+static bool writeAll(int fd, const char* data, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t written = ::write(fd, data, len);
+		if (written < 0)
+		{
+			if (errno == EINTR && !g_stop) continue;
+			return false;
+		}
+		data += written;
+		len -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+/**
+ * Constructor
+ *
+ * @param exchange The loaded exchange answering requests. It must outlive the server.
+ * @param database The database file reloaded on SIGHUP.
+ */
+ExchangeServer::ExchangeServer(BitCoinExchange& exchange, const std::string& database)
+	: _exchange(exchange), _database(database), _reloaderStarted(false), _reloading(0),
+	  _epoll(-1), _listener(-1) {}
+
+/**
+ * Destructor
+ *
+ * Closes every client, the listening socket and removes the socket file.
+ */
+ExchangeServer::~ExchangeServer()
+{
+	shutdown();
+}
+
+/**
+ * Reload thread: loads the rows appended to the database file and publishes them.
+ *
+ * A replaced or rewritten file is loaded again in full (see BitCoinExchange::refreshDatabase).
+ * A failed reload keeps the current rates and is only reported on stderr.
+ *
+ * @param arg The server.
+ * @return NULL.
+ */
+void* ExchangeServer::reload(void* arg)
+{
+	ExchangeServer* server = static_cast<ExchangeServer*>(arg);
+
+	try {
+		server->_exchange.refreshDatabase(server->_database);
+	} catch (const std::exception& e) {
+		std::cerr << BRED "❌ Error: reload failed: " << e.what() << RESET << std::endl;
+	}
+	__atomic_store_n(&server->_reloading, 0, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/**
+ * Starts a background reload of the database, unless one is already running.
+ */
+void ExchangeServer::startReload()
+{
+	g_reload = 0;
+	if (__atomic_load_n(&_reloading, __ATOMIC_ACQUIRE))
+		return;
+	joinReload();
+	_reloading = 1;
+	if (pthread_create(&_reloader, NULL, reload, this) != 0)
+	{
+		_reloading = 0;
+		std::cerr << BRED "❌ Error: reload failed: could not start thread." RESET << std::endl;
+		return;
+	}
+	_reloaderStarted = true;
+}
+
+/**
+ * Waits for the last reload thread, if any.
+ */
+void ExchangeServer::joinReload()
+{
+	if (!_reloaderStarted)
+		return;
+	pthread_join(_reloader, NULL);
+	_reloaderStarted = false;
+}
+
+/**
+ * Answers every complete line of an input buffer.
+ *
+ * The answered lines are removed from the buffer; an incomplete last line is kept for the next
+ * read unless `final` is set, in which case it is answered too.
+ *
+ * @param input The bytes received and not answered yet.
+ * @param final true when no more input will arrive.
+ * @param output Receives the response lines.
+ * @return The number of bytes left in the input buffer.
+ */
+size_t ExchangeServer::answer(std::vector<char>& input, bool final, std::vector<char>& output) const
+{
+	if (input.empty())
+		return 0;
+
+	const char* begin = &input[0];
+	const char* end = begin + input.size();
+	const char* stop = end;
+
+	if (!final)
+	{
+		stop = begin;
+		for (const char* p = end; p > begin; --p)
+		{
+			if (p[-1] == '\n')
+			{
+				stop = p;
+				break;
+			}
+		}
+	}
+	if (stop > begin)
+	{
+		OutputBuffer out(output);
+		_exchange.valueRange(begin, stop, out);
+		out.flush();
+	}
+	input.erase(input.begin(), input.begin() + (stop - begin));
+	return input.size();
+}
+
+/**
+ * Answers a request line longer than MAX_LINE with an error line, so that the client still gets
+ * exactly one response for it.
+ *
+ * @param output Receives the error line.
+ */
+void ExchangeServer::rejectLine(std::vector<char>& output) const
+{
+	OutputBuffer out(output);
+	_exchange.appendError(out, "Error: line too long.");
+	out.flush();
+}
+
+/**
+ * Drops the start of an input buffer up to and including its first newline.
+ *
+ * @param input The bytes received and not answered yet.
+ * @return true if a newline was found, false if the whole buffer was dropped.
+ */
+bool ExchangeServer::skipLine(std::vector<char>& input)
+{
+	std::vector<char>::iterator newline = std::find(input.begin(), input.end(), '\n');
+	bool found = newline != input.end();
+	input.erase(input.begin(), found ? newline + 1 : input.end());
+	return found;
+}
+
+/**
+ * Serves requests read from stdin and answers them on stdout.
+ *
+ * A request longer than MAX_LINE is answered with an error line, and the rest of it is skipped
+ * up to the next newline.
+ *
+ * Reads are done in large blocks and each block's complete lines are answered with a single
+ * write, which keeps pipelined clients (and plain redirected files) fast.
+ *
+ * @throw std::runtime_error if stdin cannot be read or stdout cannot be written.
+ */
+void ExchangeServer::serveStdio()
+{
+	std::vector<char> input;
+	std::vector<char> output;
+	char buffer[READ_SIZE];
+	bool discarding = false;
+
+	installSignals();
+	SignalBlock signals;
+	while (!g_stop)
+	{
+		if (g_reload)
+		{
+			startReload();
+			continue;
+		}
+		struct pollfd stdinReady;
+		stdinReady.fd = STDIN_FILENO;
+		stdinReady.events = POLLIN;
+		stdinReady.revents = 0;
+		ssize_t received = -1;
+		if (ppoll(&stdinReady, 1, NULL, signals.waiting()) >= 0)
+			received = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+		if (received < 0)
+		{
+			if (errno == EINTR) continue;
+			joinReload();
+			throw std::runtime_error("could not read requests.");
+		}
+		input.insert(input.end(), buffer, buffer + received);
+		if (discarding)
+			discarding = !skipLine(input);
+		if (!discarding && answer(input, received == 0, output) > MAX_LINE)
+		{
+			rejectLine(output);
+			discarding = !skipLine(input);
+		}
+		if (!output.empty() && !writeAll(STDOUT_FILENO, &output[0], output.size()))
+		{
+			joinReload();
+			throw std::runtime_error("could not write responses.");
+		}
+		output.clear();
+		if (received == 0)
+			break;
+	}
+	joinReload();
+}
+
+/**
+ * Serves requests from clients of a Unix domain socket.
+ *
+ * Any stale socket file at the path is replaced. The listening socket and every client are
+ * non-blocking and multiplexed by a single epoll instance; responses that cannot be written at
+ * once are queued and sent when the client becomes writable again.
+ *
+ * @param path The filesystem path of the socket.
+ * @throw std::runtime_error if the socket cannot be set up or epoll fails.
+ */
+void ExchangeServer::serveSocket(const std::string& path)
+{
+	struct sockaddr_un addr;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path))
+		throw std::runtime_error("invalid socket path.");
+
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+	_listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (_listener < 0)
+		throw std::runtime_error("could not create socket.");
+	::unlink(path.c_str());
+	if (::bind(_listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+		|| ::listen(_listener, SOMAXCONN) < 0)
+	{
+		shutdown();
+		throw std::runtime_error("could not listen on socket.");
+	}
+	_path = path;
+
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = _listener;
+	if (_epoll < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, _listener, &ev) < 0)
+	{
+		shutdown();
+		throw std::runtime_error("could not set up epoll.");
+	}
+
+	installSignals();
+	SignalBlock signals;
+	struct epoll_event events[64];
+	while (!g_stop)
+	{
+		if (g_reload)
+		{
+			startReload();
+			continue;
+		}
+		int ready = epoll_pwait(_epoll, events, 64, -1, signals.waiting());
+		if (ready < 0)
+		{
+			if (errno == EINTR) continue;
+			shutdown();
+			throw std::runtime_error("epoll_wait failed.");
+		}
+		for (int i = 0; i < ready; i++)
+		{
+			int fd = events[i].data.fd;
+			if (fd == _listener)
+			{
+				acceptClients();
+				continue;
+			}
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+				readClient(fd);
+			if (_connections.count(fd) && (events[i].events & EPOLLOUT))
+				writeClient(fd);
+		}
+	}
+	shutdown();
+}
+
+/**
+ * Accepts every pending client and registers it with epoll.
+ */
+void ExchangeServer::acceptClients()
+{
+	for (;;)
+	{
+		int fd = ::accept4(_listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		struct epoll_event ev;
+		std::memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		ev.data.fd = fd;
+		if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+		{
+			::close(fd);
+			continue;
+		}
+		Connection& conn = _connections[fd];
+		conn.sent = 0;
+		conn.closing = false;
+	}
+}
+
+/**
+ * Reads one chunk from a readable client, answers its complete lines and sends the responses.
+ *
+ * A single read per event keeps a client that sends without pause from starving the others:
+ * epoll reports it again on the next pass if more is waiting. A client whose responses are
+ * piling up unread is not read from until it catches up (see writeClient). A request longer
+ * than MAX_LINE is answered with an error line, then the client is closed.
+ *
+ * @param fd The client socket.
+ */
+void ExchangeServer::readClient(int fd)
+{
+	Connection& conn = _connections[fd];
+	if (conn.output.size() - conn.sent > MAX_PENDING)
+	{
+		writeClient(fd);
+		return;
+	}
+
+	char buffer[READ_SIZE];
+	bool eof = false;
+	ssize_t received;
+	do
+		received = ::read(fd, buffer, sizeof(buffer));
+	while (received < 0 && errno == EINTR);
+	if (received > 0)
+		conn.input.insert(conn.input.end(), buffer, buffer + received);
+	else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+		eof = true;
+
+	if (answer(conn.input, eof, conn.output) > MAX_LINE)
+	{
+		rejectLine(conn.output);
+		eof = true;
+	}
+	if (eof)
+		conn.closing = true;
+	writeClient(fd);
+}
+
+/**
+ * Sends as much queued output as the client accepts, then updates its epoll interest.
+ *
+ * Reading stays disabled while more than MAX_PENDING bytes of responses wait to be sent, so a
+ * client that never reads cannot make the server buffer without limit.
+ *
+ * @param fd The client socket.
+ */
+void ExchangeServer::writeClient(int fd)
+{
+	Connection& conn = _connections[fd];
+
+	while (conn.sent < conn.output.size())
+	{
+		ssize_t written = ::write(fd, &conn.output[conn.sent], conn.output.size() - conn.sent);
+		if (written < 0)
+		{
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			closeClient(fd);
+			return;
+		}
+		conn.sent += static_cast<size_t>(written);
+	}
+
+	bool pending = conn.sent < conn.output.size();
+	if (!pending)
+	{
+		conn.output.clear();
+		conn.sent = 0;
+		if (conn.closing)
+		{
+			closeClient(fd);
+			return;
+		}
+	}
+
+	struct epoll_event ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = 0;
+	if (!conn.closing && conn.output.size() - conn.sent <= MAX_PENDING)
+		ev.events |= EPOLLIN | EPOLLRDHUP;
+	if (pending)
+		ev.events |= EPOLLOUT;
+	ev.data.fd = fd;
+	epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/**
+ * Unregisters and closes a client.
+ *
+ * @param fd The client socket.
+ */
+void ExchangeServer::closeClient(int fd)
+{
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, NULL);
+	::close(fd);
+	_connections.erase(fd);
+}
+
+/**
+ * Waits for a running reload, closes every descriptor owned by the server and removes the
+ * socket file.
+ */
+void ExchangeServer::shutdown()
+{
+	joinReload();
+	while (!_connections.empty())
+		closeClient(_connections.begin()->first);
+	if (_listener >= 0)
+		::close(_listener);
+	if (_epoll >= 0)
+		::close(_epoll);
+	if (!_path.empty())
+		::unlink(_path.c_str());
+	_listener = -1;
+	_epoll = -1;
+	_path.clear();
+}
@@ -0,0 +1,133 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MappedFile.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 09:40:12 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/21 09:40:12 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/MappedFile.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Default constructor
+ *
+ * Initializes an object that maps nothing.
+ */
+MappedFile::MappedFile() : _data(NULL), _size(0), _open(false), _device(0), _inode(0) {}
+
+/**
+ * Destructor
+ *
+ * Releases the mapping, if any.
+ */
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/**
+ * Maps the whole file in read-only mode.
+ *
+ * Any previous mapping is released first. An empty file is opened successfully
+ * with a NULL data pointer and a size of zero, since zero-length mappings are
+ * not allowed.
+ *
+ * @param filename The path of the file to map.
+ * @return true on success, false if the file could not be opened or mapped.
+ */
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	if (st.st_size > 0)
+	{
+		void* addr = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+		_data = static_cast<const char*>(addr);
+		_size = static_cast<size_t>(st.st_size);
+	}
+	::close(fd);
+	_device = static_cast<uint64_t>(st.st_dev);
+	_inode = static_cast<uint64_t>(st.st_ino);
+	_open = true;
+	return true;
+}
+
+/**
+ * Releases the mapping. Safe to call on a closed object.
+ */
+void MappedFile::close()
+{
+	if (_data)
+		munmap(const_cast<char*>(_data), _size);
+	_data = NULL;
+	_size = 0;
+	_open = false;
+	_device = 0;
+	_inode = 0;
+}
+
+/**
+ * @return true if a file is currently mapped.
+ */
+bool MappedFile::isOpen() const
+{
+	return _open;
+}
+
+/**
+ * @return The first byte of the mapping, or NULL for an empty file.
+ */
+const char* MappedFile::data() const
+{
+	return _data;
+}
+
+/**
+ * @return The size of the mapping in bytes.
+ */
+size_t MappedFile::size() const
+{
+	return _size;
+}
+
+/**
+ * @return The device holding the mapped file, which together with the inode
+ * identifies the file even if it is renamed.
+ */
+uint64_t MappedFile::device() const
+{
+	return _device;
+}
+
+/**
+ * @return The inode number of the mapped file.
+ */
+uint64_t MappedFile::inode() const
+{
+	return _inode;
+}
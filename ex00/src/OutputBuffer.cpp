@@ -0,0 +1,88 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputBuffer.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/22 14:20:31 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/22 14:20:31 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/OutputBuffer.hpp"
+#include <stdexcept>
+#include <cerrno>
+#include <unistd.h>
+
+/**
+ * Constructor
+ *
+ * @param fd The file descriptor the buffer writes to. It is not closed.
+ */
+OutputBuffer::OutputBuffer(int fd) : _fd(fd), _sink(NULL), _used(0) {}
+
+/**
+ * Constructor
+ *
+ * @param sink The vector flushed bytes are appended to.
+ */
+OutputBuffer::OutputBuffer(std::vector<char>& sink) : _fd(-1), _sink(&sink), _used(0) {}
+
+/**
+ * Destructor
+ *
+ * Writes whatever is still buffered. Errors are ignored here since a
+ * destructor must not throw; call flush() explicitly to detect them.
+ */
+OutputBuffer::~OutputBuffer()
+{
+	try {
+		flush();
+	} catch (const std::exception&) {}
+}
+
+/**
+ * Writes the buffered bytes to the file descriptor or memory sink.
+ *
+ * @throw std::runtime_error if write(2) fails.
+ */
+void OutputBuffer::flush()
+{
+	size_t used = _used;
+	_used = 0;
+	writeAll(_buffer, used);
+}
+
+/**
+ * @return The file descriptor the buffer writes to, or -1 for a memory sink.
+ */
+int OutputBuffer::fd() const
+{
+	return _fd;
+}
+
+/**
+ * Writes a whole range, retrying on partial writes and interruptions.
+ *
+ * @throw std::runtime_error if write(2) fails.
+ */
+void OutputBuffer::writeAll(const char* data, size_t len)
+{
+	if (_sink)
+	{
+		_sink->insert(_sink->end(), data, data + len);
+		return;
+	}
+	while (len > 0)
+	{
+		ssize_t written = ::write(_fd, data, len);
+		if (written < 0)
+		{
+			if (errno == EINTR) continue;
+			throw std::runtime_error("could not write output.");
+		}
+		data += written;
+		len -= static_cast<size_t>(written);
+	}
+}
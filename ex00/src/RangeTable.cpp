@@ -0,0 +1,213 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RangeTable.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/04 14:27:05 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/04 14:27:05 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/RangeTable.hpp"
+#include <algorithm>
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty table.
+ */
+RangeTable::RangeTable() {}
+
+/**
+ * Copy constructor
+ *
+ * @param other The table to copy from.
+ */
+RangeTable::RangeTable(const RangeTable& other)
+	: _sums(other._sums), _areas(other._areas), _min(other._min), _max(other._max) {}
+
+/**
+ * Destructor
+ */
+RangeTable::~RangeTable() {}
+
+/**
+ * Assignment operator
+ *
+ * @param other The table to assign from.
+ * @return A reference to this table.
+ */
+RangeTable& RangeTable::operator=(const RangeTable& other)
+{
+	if (this != &other)
+	{
+		_sums = other._sums;
+		_areas = other._areas;
+		_min = other._min;
+		_max = other._max;
+	}
+	return *this;
+}
+
+/**
+ * Builds the prefix sums and the block sparse table of a frozen rate index.
+ *
+ * The table refers to the rows of the index by position, so it must be queried with the same
+ * index, and rebuilt whenever the index changes.
+ *
+ * @param index The index to summarize.
+ */
+void RangeTable::build(const RateIndex& index)
+{
+	clear();
+	size_t count = index.size();
+	if (count == 0)
+		return;
+
+	_sums.resize(count + 1);
+	_areas.resize(count);
+	_sums[0] = 0;
+	_areas[0] = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		_sums[i + 1] = _sums[i] + index.rateAt(i);
+		if (i + 1 < count)
+			_areas[i + 1] = _areas[i]
+				+ static_cast<double>(index.rateAt(i)) * (index.dayAt(i + 1) - index.dayAt(i));
+	}
+
+	size_t blocks = (count + BLOCK - 1) / BLOCK;
+	_min.push_back(std::vector<float>(blocks));
+	_max.push_back(std::vector<float>(blocks));
+	for (size_t b = 0; b < blocks; b++)
+	{
+		const float* rates = index.rates() + b * BLOCK;
+		const float* end = index.rates() + std::min(count, (b + 1) * BLOCK);
+		_min[0][b] = *std::min_element(rates, end);
+		_max[0][b] = *std::max_element(rates, end);
+	}
+
+	for (size_t width = 2; width <= blocks; width *= 2)
+	{
+		const std::vector<float>& lowMin = _min.back();
+		const std::vector<float>& lowMax = _max.back();
+		size_t half = width / 2;
+		std::vector<float> levelMin(blocks - width + 1);
+		std::vector<float> levelMax(blocks - width + 1);
+		for (size_t b = 0; b + width <= blocks; b++)
+		{
+			levelMin[b] = std::min(lowMin[b], lowMin[b + half]);
+			levelMax[b] = std::max(lowMax[b], lowMax[b + half]);
+		}
+		_min.push_back(levelMin);
+		_max.push_back(levelMax);
+	}
+}
+
+/**
+ * Empties the table.
+ */
+void RangeTable::clear()
+{
+	std::vector<double>().swap(_sums);
+	std::vector<double>().swap(_areas);
+	_min.clear();
+	_max.clear();
+}
+
+/**
+ * @return true if the table was not built or summarizes an empty index.
+ */
+bool RangeTable::empty() const
+{
+	return _sums.empty();
+}
+
+/**
+ * Finds the minimum and maximum rates between two rows.
+ *
+ * The partial blocks at both ends are scanned; the whole blocks between them are covered by two
+ * overlapping power-of-two windows of the sparse table.
+ *
+ * @param index The summarized index.
+ * @param first The position of the first row.
+ * @param last The position of the last row, not before first.
+ * @param min Receives the minimum rate.
+ * @param max Receives the maximum rate.
+ */
+void RangeTable::extremes(const RateIndex& index, size_t first, size_t last, float& min, float& max) const
+{
+	const float* rates = index.rates();
+	size_t firstBlock = first / BLOCK;
+	size_t lastBlock = last / BLOCK;
+
+	if (lastBlock - firstBlock < 2)
+	{
+		min = *std::min_element(rates + first, rates + last + 1);
+		max = *std::max_element(rates + first, rates + last + 1);
+		return;
+	}
+
+	const float* headEnd = rates + (firstBlock + 1) * BLOCK;
+	const float* tailBegin = rates + lastBlock * BLOCK;
+	min = std::min(*std::min_element(rates + first, headEnd), *std::min_element(tailBegin, rates + last + 1));
+	max = std::max(*std::max_element(rates + first, headEnd), *std::max_element(tailBegin, rates + last + 1));
+
+	size_t from = firstBlock + 1;
+	size_t blocks = lastBlock - from;
+	size_t level = 0;
+	while ((static_cast<size_t>(2) << level) <= blocks)
+		++level;
+	size_t other = lastBlock - (static_cast<size_t>(1) << level);
+	min = std::min(min, std::min(_min[level][from], _min[level][other]));
+	max = std::max(max, std::max(_max[level][from], _max[level][other]));
+}
+
+/**
+ * Sums the rates in effect on every day from the first row of the history up to a day, excluded.
+ *
+ * @param index The summarized index.
+ * @param day The first day not counted.
+ * @return The sum of the daily rates.
+ */
+double RangeTable::area(const RateIndex& index, uint32_t day) const
+{
+	if (day <= index.dayAt(0))
+		return 0;
+	size_t pos = index.floor(day - 1);
+	return _areas[pos] + static_cast<double>(index.rateAt(pos)) * (day - index.dayAt(pos));
+}
+
+/**
+ * Summarizes the rates in effect between two dates.
+ *
+ * @param index The summarized index.
+ * @param from The day number of the first date of the range.
+ * @param to The day number of the last date of the range, included.
+ * @param summary Receives the aggregates: the days actually covered (from the first day with a
+ * rate), the number of rates in effect, their minimum, maximum and mean, and the mean of the
+ * daily rates, in which every rate weighs the number of days it stays in effect.
+ * @return true on success, false if the range is reversed or no rate is in effect in it.
+ */
+bool RangeTable::query(const RateIndex& index, uint32_t from, uint32_t to, Summary& summary) const
+{
+	if (empty() || to < from)
+		return false;
+	size_t last = index.floor(to);
+	if (last == RateIndex::npos)
+		return false;
+	size_t first = index.floor(from);
+	if (first == RateIndex::npos)
+		first = 0;
+
+	summary.firstDay = std::max(from, index.dayAt(0));
+	summary.lastDay = to;
+	summary.rates = last - first + 1;
+	extremes(index, first, last, summary.min, summary.max);
+	summary.mean = (_sums[last + 1] - _sums[first]) / static_cast<double>(summary.rates);
+	summary.timeWeighted = (area(index, to + 1) - area(index, summary.firstDay))
+		/ static_cast<double>(to + 1 - summary.firstDay);
+	return true;
+}
@@ -0,0 +1,532 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RateIndex.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/20 10:15:40 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/20 10:15:40 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/RateIndex.hpp"
+
+/**
+ * Computes 10^N at compile time, so that FIXED_UNIT follows FIXED_SCALE.
+ */
+template <int N>
+struct PowerOfTen
+{
+	static const int64_t value = 10 * PowerOfTen<N - 1>::value;
+};
+
+template <>
+struct PowerOfTen<0>
+{
+	static const int64_t value = 1;
+};
+
+const size_t RateIndex::npos = static_cast<size_t>(-1);
+const int64_t RateIndex::INEXACT_RATE = -0x7FFFFFFFFFFFFFFFLL - 1;
+const int64_t RateIndex::FIXED_UNIT = PowerOfTen<RateIndex::FIXED_SCALE>::value;
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty index.
+ */
+RateIndex::RateIndex() : _mapping(NULL), _dayData(NULL), _rateData(NULL), _fixedData(NULL), _count(0) {}
+
+/**
+ * Copy constructor
+ *
+ * @param other The index to copy from.
+ */
+RateIndex::RateIndex(const RateIndex& other)
+	: _days(other._dayData, other._dayData + other._count),
+	_rates(other._rateData, other._rateData + other._count),
+	_fixedRates(other._fixedData, other._fixedData + other._count),
+	_mapping(NULL), _dayData(NULL), _rateData(NULL), _fixedData(NULL), _count(0)
+{
+	sync();
+}
+
+/**
+ * Destructor
+ *
+ * Releases the adopted mapping, if any.
+ */
+RateIndex::~RateIndex()
+{
+	delete _mapping;
+}
+
+/**
+ * Assignment operator
+ *
+ * @param other The index to assign from.
+ * @return A reference to this index.
+ */
+RateIndex& RateIndex::operator=(const RateIndex& other)
+{
+	if (this != &other)
+	{
+		std::vector<uint32_t> days(other._dayData, other._dayData + other._count);
+		std::vector<float> rates(other._rateData, other._rateData + other._count);
+		std::vector<int64_t> fixedRates(other._fixedData, other._fixedData + other._count);
+		delete _mapping;
+		_mapping = NULL;
+		_days.swap(days);
+		_rates.swap(rates);
+		_fixedRates.swap(fixedRates);
+		sync();
+	}
+	return *this;
+}
+
+/**
+ * Removes every entry from the index.
+ */
+void RateIndex::clear()
+{
+	delete _mapping;
+	_mapping = NULL;
+	_days.clear();
+	_rates.clear();
+	_fixedRates.clear();
+	sync();
+}
+
+/**
+ * Reserves room for the given number of rows.
+ *
+ * @param count The expected number of rows.
+ */
+void RateIndex::reserve(size_t count)
+{
+	materialize();
+	_days.reserve(count);
+	_rates.reserve(count);
+	_fixedRates.reserve(count);
+	sync();
+}
+
+/**
+ * Appends a row. The index must be frozen again before it is searched.
+ *
+ * The fixed-point rate is derived from the float, so it is only as exact as the float is.
+ *
+ * @param day The day number of the row.
+ * @param rate The exchange rate of the row.
+ */
+void RateIndex::insert(uint32_t day, float rate)
+{
+	double scaled = static_cast<double>(rate) * static_cast<double>(FIXED_UNIT);
+	insert(day, rate, static_cast<int64_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5));
+}
+
+/**
+ * Appends a row. The index must be frozen again before it is searched.
+ *
+ * @param day The day number of the row.
+ * @param rate The exchange rate of the row.
+ * @param fixedRate The exchange rate times 10^FIXED_SCALE.
+ */
+void RateIndex::insert(uint32_t day, float rate, int64_t fixedRate)
+{
+	materialize();
+	_days.push_back(day);
+	_rates.push_back(rate);
+	_fixedRates.push_back(fixedRate);
+	sync();
+}
+
+/**
+ * Compares two row positions by date, used by RateIndex::freeze to sort a
+ * permutation of the rows.
+ */
+struct DayOrder
+{
+	const std::vector<uint32_t>* days;
+
+	bool operator()(size_t a, size_t b) const
+	{
+		return (*days)[a] < (*days)[b];
+	}
+};
+
+/**
+ * Sorts the rows by date and removes duplicated dates.
+ *
+ * Input files are normally already sorted, in which case only the duplicate
+ * pass runs. Otherwise a permutation is stable-sorted so that, among rows with
+ * the same date, the last inserted one is the one kept.
+ */
+void RateIndex::freeze()
+{
+	materialize();
+	size_t count = _days.size();
+	bool sorted = true;
+
+	for (size_t i = 1; i < count && sorted; i++)
+		sorted = (_days[i - 1] <= _days[i]);
+
+	if (!sorted)
+	{
+		std::vector<size_t> order(count);
+		for (size_t i = 0; i < count; i++)
+			order[i] = i;
+		DayOrder cmp;
+		cmp.days = &_days;
+		std::stable_sort(order.begin(), order.end(), cmp);
+
+		std::vector<uint32_t> days(count);
+		std::vector<float> rates(count);
+		std::vector<int64_t> fixedRates(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			days[i] = _days[order[i]];
+			rates[i] = _rates[order[i]];
+			fixedRates[i] = _fixedRates[order[i]];
+		}
+		_days.swap(days);
+		_rates.swap(rates);
+		_fixedRates.swap(fixedRates);
+	}
+
+	size_t out = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (out > 0 && _days[out - 1] == _days[i])
+			--out;
+		_days[out] = _days[i];
+		_rates[out] = _rates[i];
+		_fixedRates[out] = _fixedRates[i];
+		++out;
+	}
+	_days.resize(out);
+	_rates.resize(out);
+	_fixedRates.resize(out);
+	sync();
+}
+
+/**
+ * Merges the rows of another frozen index into this frozen one.
+ *
+ * Rows dated after the last date of this index are appended. Otherwise only the rows from the
+ * first date not earlier than the oldest newer row are merged with the newer rows; the earlier
+ * part of the arrays is left untouched. When both indexes hold the same date, the newer rate
+ * wins, as if the rows had been inserted after the existing ones before freezing.
+ *
+ * @param newer The frozen index holding the rows to add.
+ */
+void RateIndex::merge(const RateIndex& newer)
+{
+	if (newer.empty())
+		return;
+	materialize();
+
+	const uint32_t* days = newer._dayData;
+	const float* rates = newer._rateData;
+	const int64_t* fixedRates = newer._fixedData;
+	size_t count = newer._count;
+	size_t start = static_cast<size_t>(
+		std::lower_bound(_days.begin(), _days.end(), days[0]) - _days.begin());
+
+	if (start == _days.size())
+	{
+		_days.insert(_days.end(), days, days + count);
+		_rates.insert(_rates.end(), rates, rates + count);
+		_fixedRates.insert(_fixedRates.end(), fixedRates, fixedRates + count);
+		sync();
+		return;
+	}
+
+	size_t size = _days.size();
+	std::vector<uint32_t> mergedDays;
+	std::vector<float> mergedRates;
+	std::vector<int64_t> mergedFixed;
+	mergedDays.reserve(size - start + count);
+	mergedRates.reserve(size - start + count);
+	mergedFixed.reserve(size - start + count);
+
+	size_t i = start;
+	size_t j = 0;
+	while (i < size || j < count)
+	{
+		if (j == count || (i < size && _days[i] < days[j]))
+		{
+			mergedDays.push_back(_days[i]);
+			mergedRates.push_back(_rates[i]);
+			mergedFixed.push_back(_fixedRates[i]);
+			++i;
+			continue;
+		}
+		if (i < size && _days[i] == days[j])
+			++i;
+		mergedDays.push_back(days[j]);
+		mergedRates.push_back(rates[j]);
+		mergedFixed.push_back(fixedRates[j]);
+		++j;
+	}
+
+	_days.resize(start);
+	_rates.resize(start);
+	_fixedRates.resize(start);
+	_days.insert(_days.end(), mergedDays.begin(), mergedDays.end());
+	_rates.insert(_rates.end(), mergedRates.begin(), mergedRates.end());
+	_fixedRates.insert(_fixedRates.end(), mergedFixed.begin(), mergedFixed.end());
+	sync();
+}
+
+/**
+ * Makes the index search arrays owned by a memory mapping.
+ *
+ * The arrays must already be sorted by date without duplicates. The index takes ownership of the
+ * mapping and releases it when cleared, modified or destroyed.
+ *
+ * @param mapping The mapping holding the arrays, allocated with new.
+ * @param days The sorted day number array inside the mapping.
+ * @param rates The rate array inside the mapping.
+ * @param fixedRates The fixed-point rate array inside the mapping.
+ * @param count The number of rows.
+ */
+void RateIndex::adopt(MappedFile* mapping, const uint32_t* days, const float* rates,
+	const int64_t* fixedRates, size_t count)
+{
+	clear();
+	_mapping = mapping;
+	_dayData = days;
+	_rateData = rates;
+	_fixedData = fixedRates;
+	_count = count;
+}
+
+/**
+ * @return true if the index currently searches a memory mapping.
+ */
+bool RateIndex::isMapped() const
+{
+	return _mapping != NULL;
+}
+
+/**
+ * Copies adopted rows into the owned vectors so that they can be modified.
+ */
+void RateIndex::materialize()
+{
+	if (!_mapping)
+		return;
+	_days.assign(_dayData, _dayData + _count);
+	_rates.assign(_rateData, _rateData + _count);
+	_fixedRates.assign(_fixedData, _fixedData + _count);
+	delete _mapping;
+	_mapping = NULL;
+	sync();
+}
+
+/**
+ * Points the search arrays at the owned vectors.
+ */
+void RateIndex::sync()
+{
+	_dayData = _days.empty() ? NULL : &_days[0];
+	_rateData = _rates.empty() ? NULL : &_rates[0];
+	_fixedData = _fixedRates.empty() ? NULL : &_fixedRates[0];
+	_count = _days.size();
+}
+
+/**
+ * @return The number of distinct dates in the index.
+ */
+size_t RateIndex::size() const
+{
+	return _count;
+}
+
+/**
+ * @return true if the index holds no rates.
+ */
+bool RateIndex::empty() const
+{
+	return _count == 0;
+}
+
+/**
+ * Finds the position of the given date or, failing that, of the closest
+ * earlier date.
+ *
+ * @param day The day number to look up.
+ * @return The position of the matching row, or RateIndex::npos if every date
+ * in the index is later than the requested one.
+ */
+size_t RateIndex::floor(uint32_t day) const
+{
+	return floorSearch(_dayData, _count, day);
+}
+
+/**
+ * Resolves a batch of ascending dates with a single merge walk over the index.
+ *
+ * The walk keeps a cursor on the index and moves it forward with a galloping
+ * (exponential then binary) search, so a batch costs O(Q + N) when queries are
+ * dense and degrades gracefully to O(Q log(N / Q)) when they are sparse.
+ *
+ * @param days The queried day numbers, sorted in ascending order.
+ * @param count The number of queries.
+ * @param positions Receives, for each query, the same position RateIndex::floor
+ * would return.
+ */
+void RateIndex::floorSorted(const uint32_t* days, size_t count, size_t* positions) const
+{
+	size_t cursor = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t day = days[i];
+		if (_count == 0 || day < _dayData[0])
+		{
+			positions[i] = npos;
+			continue;
+		}
+
+		// Gallop: find a window [cursor + step / 2, cursor + step] holding the answer.
+		size_t step = 1;
+		while (cursor + step < _count && _dayData[cursor + step] <= day)
+			step *= 2;
+		size_t low = cursor + step / 2;
+		size_t high = std::min(cursor + step, _count);
+		cursor = low + floorSearch(_dayData + low, high - low, day);
+		positions[i] = cursor;
+	}
+}
+
+/**
+ * Resolves a batch of dates in any order with interleaved binary searches.
+ *
+ * A lone search is bound by memory latency: each step waits for the row it
+ * compares against before it knows where to look next. Here the queries are
+ * searched BATCH_LANES at a time in lockstep. All lanes search an array of the
+ * same length, so they halve their range together; at every step each lane
+ * settles its comparison and prefetches the row its next step will read, so
+ * up to BATCH_LANES cache misses are in flight instead of one.
+ *
+ * @param days The queried day numbers, in any order.
+ * @param count The number of queries.
+ * @param positions Receives, for each query, the same position RateIndex::floor
+ * would return.
+ */
+void RateIndex::floorBatch(const uint32_t* days, size_t count, size_t* positions) const
+{
+	if (_count == 0)
+	{
+		std::fill(positions, positions + count, npos);
+		return;
+	}
+
+	size_t bases[BATCH_LANES];
+	for (size_t start = 0; start < count; start += BATCH_LANES)
+	{
+		size_t lanes = (count - start < BATCH_LANES) ? count - start : BATCH_LANES;
+		const uint32_t* query = days + start;
+		for (size_t j = 0; j < lanes; j++)
+			bases[j] = 0;
+
+		size_t length = _count;
+		while (length > 1)
+		{
+			size_t half = length / 2;
+			size_t next = (length - half) / 2;
+			for (size_t j = 0; j < lanes; j++)
+			{
+				size_t base = bases[j] + ((_dayData[bases[j] + half] <= query[j]) ? half : 0);
+				bases[j] = base;
+				__builtin_prefetch(_dayData + base + next);
+			}
+			length -= half;
+		}
+
+		for (size_t j = 0; j < lanes; j++)
+			positions[start + j] = (query[j] < _dayData[bases[j]]) ? npos : bases[j];
+	}
+}
+
+/**
+ * @param pos A position returned by RateIndex::floor.
+ * @return The day number stored at that position.
+ */
+uint32_t RateIndex::dayAt(size_t pos) const
+{
+	return _dayData[pos];
+}
+
+/**
+ * @param pos A position returned by RateIndex::floor.
+ * @return The exchange rate stored at that position.
+ */
+float RateIndex::rateAt(size_t pos) const
+{
+	return _rateData[pos];
+}
+
+/**
+ * @param pos A position returned by RateIndex::floor.
+ * @return The exchange rate stored at that position, times 10^FIXED_SCALE.
+ */
+int64_t RateIndex::fixedRateAt(size_t pos) const
+{
+	return _fixedData[pos];
+}
+
+/**
+ * @return The sorted day number array, or NULL when the index is empty.
+ */
+const uint32_t* RateIndex::days() const
+{
+	return _dayData;
+}
+
+/**
+ * @return The rate array parallel to RateIndex::days, or NULL when empty.
+ */
+const float* RateIndex::rates() const
+{
+	return _rateData;
+}
+
+/**
+ * @return The fixed-point rate array parallel to RateIndex::days, or NULL when empty.
+ */
+const int64_t* RateIndex::fixedRates() const
+{
+	return _fixedData;
+}
+
+/**
+ * Branchless search for the last element not greater than the given day.
+ *
+ * Each step halves the remaining range and moves the base with a conditional
+ * move instead of a branch, so the loop runs a fixed log2(count) iterations
+ * with no mispredictions. This keeps the "exact date, otherwise the closest
+ * earlier date" meaning of the former std::map lower_bound/--it lookup.
+ *
+ * @param days A sorted array of day numbers.
+ * @param count The number of elements in the array.
+ * @param day The day number to look up.
+ * @return The position found, or RateIndex::npos if all days are later.
+ */
+size_t RateIndex::floorSearch(const uint32_t* days, size_t count, uint32_t day)
+{
+	if (count == 0 || day < days[0])
+		return npos;
+
+	const uint32_t* base = days;
+	while (count > 1)
+	{
+		size_t half = count / 2;
+		base = (base[half] <= day) ? base + half : base;
+		count -= half;
+	}
+	return static_cast<size_t>(base - days);
+}
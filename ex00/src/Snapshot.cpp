@@ -0,0 +1,144 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Snapshot.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/24 16:05:48 by meferraz          #+#    #+#             */
+/*   Updated: 2025/08/24 16:05:48 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Snapshot.hpp"
+#include "../inc/OutputBuffer.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char g_magic[8] = { 'B', 'T', 'C', 'S', 'N', 'A', 'P', '\0' };
+
+/**
+ * Reads the size and modification time of a source file. The time keeps its nanoseconds, so
+ * that two writes within the same second still tell apart.
+ *
+ * @param filename The file to describe.
+ * @param source Receives the file description.
+ * @return true on success, false if the file cannot be stat'ed.
+ */
+bool Snapshot::describe(const std::string& filename, Source& source)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) < 0)
+		return false;
+	source.size = static_cast<uint64_t>(st.st_size);
+	source.mtime = static_cast<int64_t>(st.st_mtim.tv_sec);
+	source.mtimeNsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+	return true;
+}
+
+/**
+ * Writes a snapshot of a frozen index.
+ *
+ * The snapshot is written to a temporary file and renamed over the target, so
+ * a concurrent reader sees either the old or the new snapshot, never a partial
+ * one.
+ *
+ * @param filename The snapshot file to create or replace.
+ * @param index The frozen index to save.
+ * @param source The description of the CSV file the index was loaded from.
+ * @return true on success, false if the snapshot could not be written.
+ */
+bool Snapshot::write(const std::string& filename, const RateIndex& index, const Source& source)
+{
+	std::ostringstream tmp;
+	tmp << filename << ".tmp." << getpid();
+	std::string tmpName = tmp.str();
+
+	int fd = ::open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, g_magic, sizeof(g_magic));
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.count = index.size();
+	header.sourceSize = source.size;
+	header.sourceMtime = source.mtime;
+	header.sourceMtimeNsec = source.mtimeNsec;
+
+	bool ok = true;
+	try {
+		OutputBuffer out(fd);
+		out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!index.empty())
+		{
+			out.append(reinterpret_cast<const char*>(index.days()), index.size() * sizeof(uint32_t));
+			out.append(reinterpret_cast<const char*>(index.rates()), index.size() * sizeof(float));
+			out.append(reinterpret_cast<const char*>(index.fixedRates()), index.size() * sizeof(int64_t));
+		}
+		out.flush();
+	} catch (const std::exception&) {
+		ok = false;
+	}
+
+	if (::close(fd) < 0)
+		ok = false;
+	if (ok && std::rename(tmpName.c_str(), filename.c_str()) != 0)
+		ok = false;
+	if (!ok)
+		std::remove(tmpName.c_str());
+	return ok;
+}
+
+/**
+ * Maps a snapshot and makes the index search it in place.
+ *
+ * Loading only validates the header (magic, version, byte order, size and
+ * source description) and sets pointers into the mapping; rows are not copied.
+ *
+ * @param filename The snapshot file.
+ * @param source The current description of the CSV file.
+ * @param index Receives the mapped rows if the snapshot is valid.
+ * @return true if the snapshot was mapped, false if it is missing, invalid or
+ * stale. The index is left untouched on failure.
+ */
+bool Snapshot::map(const std::string& filename, const Source& source, RateIndex& index)
+{
+	MappedFile* mapping = new MappedFile();
+	if (!mapping->open(filename) || mapping->size() < sizeof(Header))
+	{
+		delete mapping;
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, mapping->data(), sizeof(header));
+	uint64_t expected = sizeof(Header) + header.count * (sizeof(uint32_t) + sizeof(float) + sizeof(int64_t));
+	if (std::memcmp(header.magic, g_magic, sizeof(g_magic)) != 0
+		|| header.version != VERSION
+		|| header.byteOrder != BYTE_ORDER_MARK
+		|| header.sourceSize != source.size
+		|| header.sourceMtime != source.mtime
+		|| header.sourceMtimeNsec != source.mtimeNsec
+		|| header.count > mapping->size()
+		|| expected != mapping->size())
+	{
+		delete mapping;
+		return false;
+	}
+
+	size_t count = static_cast<size_t>(header.count);
+	const char* base = mapping->data() + sizeof(Header);
+	const uint32_t* days = reinterpret_cast<const uint32_t*>(base);
+	const float* rates = reinterpret_cast<const float*>(base + count * sizeof(uint32_t));
+	const int64_t* fixedRates = reinterpret_cast<const int64_t*>(base + count * (sizeof(uint32_t) + sizeof(float)));
+	index.adopt(mapping, days, rates, fixedRates, count);
+	return true;
+}
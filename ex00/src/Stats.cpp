@@ -0,0 +1,251 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Stats.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/02 09:12:48 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/02 09:12:48 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Stats.hpp"
+#include "../inc/ansi.h"
+#include <iomanip>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+
+static const char* const g_stageNames[Stats::STAGE_COUNT] = {
+	"load database", "split line", "parse date", "parse value", "find rate", "format output"
+};
+
+static const char* const g_counterNames[Stats::COUNTER_COUNT] = {
+	"valid lines", "bad input", "negative value", "too large value", "no rate",
+	"exact date hits", "carried-forward rates", "date cache hits", "date cache misses"
+};
+
+/**
+ * Timings and counters of one thread, or the sum of several.
+ */
+struct Record
+{
+	uint64_t counters[Stats::COUNTER_COUNT];
+	uint64_t calls[Stats::STAGE_COUNT];
+	uint64_t totalNs[Stats::STAGE_COUNT];
+	uint64_t maxNs[Stats::STAGE_COUNT];
+	uint64_t histogram[Stats::STAGE_COUNT][Stats::BUCKETS];
+
+	Record()
+	{
+		std::memset(this, 0, sizeof(*this));
+	}
+
+	void add(const Record& other)
+	{
+		for (size_t c = 0; c < Stats::COUNTER_COUNT; c++)
+			counters[c] += other.counters[c];
+		for (size_t s = 0; s < Stats::STAGE_COUNT; s++)
+		{
+			calls[s] += other.calls[s];
+			totalNs[s] += other.totalNs[s];
+			if (other.maxNs[s] > maxNs[s])
+				maxNs[s] = other.maxNs[s];
+			for (size_t b = 0; b < Stats::BUCKETS; b++)
+				histogram[s][b] += other.histogram[s][b];
+		}
+	}
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+static Record g_finished;
+
+/**
+ * Folds the record of an exiting thread into the global total.
+ */
+static void retireRecord(void* record)
+{
+	Record* mine = static_cast<Record*>(record);
+	pthread_mutex_lock(&g_lock);
+	g_finished.add(*mine);
+	pthread_mutex_unlock(&g_lock);
+	delete mine;
+}
+
+static void createKey()
+{
+	pthread_key_create(&g_key, retireRecord);
+}
+
+/**
+ * @return The record of the calling thread, created on first use.
+ */
+static Record& localRecord()
+{
+	pthread_once(&g_once, createKey);
+	Record* mine = static_cast<Record*>(pthread_getspecific(g_key));
+	if (!mine)
+	{
+		mine = new Record();
+		pthread_setspecific(g_key, mine);
+	}
+	return *mine;
+}
+
+/**
+ * @return A monotonic timestamp in nanoseconds.
+ */
+uint64_t Stats::now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * Maps a latency to its histogram bucket.
+ *
+ * Values below 2^SUB_BITS get a bucket each; above, every power of two is split into 2^SUB_BITS
+ * equal sub-buckets, so the relative error stays under 25% over the whole range.
+ *
+ * @param ns The latency in nanoseconds.
+ * @return The bucket index, below BUCKETS.
+ */
+unsigned int Stats::bucketOf(uint64_t ns)
+{
+	const unsigned int sub = 1u << SUB_BITS;
+	if (ns < sub)
+		return static_cast<unsigned int>(ns);
+
+	unsigned int msb = 63 - static_cast<unsigned int>(__builtin_clzll(ns));
+	unsigned int fraction = static_cast<unsigned int>(ns >> (msb - SUB_BITS)) & (sub - 1);
+	return (msb - SUB_BITS + 1) * sub + fraction;
+}
+
+/**
+ * @param bucket A histogram bucket index.
+ * @return The smallest latency falling into the bucket.
+ */
+uint64_t Stats::bucketFloor(unsigned int bucket)
+{
+	const unsigned int sub = 1u << SUB_BITS;
+	if (bucket < sub)
+		return bucket;
+
+	unsigned int msb = bucket / sub + SUB_BITS - 1;
+	return static_cast<uint64_t>(sub + bucket % sub) << (msb - SUB_BITS);
+}
+
+/**
+ * Increments a counter of the calling thread.
+ */
+void Stats::count(Counter counter)
+{
+	localRecord().counters[counter]++;
+}
+
+/**
+ * Records one timed run of a stage for the calling thread.
+ *
+ * @param stage The stage.
+ * @param ns The duration of the run in nanoseconds.
+ */
+void Stats::record(Stage stage, uint64_t ns)
+{
+	Record& mine = localRecord();
+	mine.calls[stage]++;
+	mine.totalNs[stage] += ns;
+	if (ns > mine.maxNs[stage])
+		mine.maxNs[stage] = ns;
+	mine.histogram[stage][bucketOf(ns)]++;
+}
+
+/**
+ * Reads a percentile from a histogram.
+ *
+ * @return The lower bound of the bucket holding the percentile.
+ */
+static uint64_t percentile(const uint64_t* histogram, uint64_t calls, double fraction)
+{
+	uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(calls));
+	uint64_t seen = 0;
+	for (unsigned int b = 0; b < Stats::BUCKETS; b++)
+	{
+		seen += histogram[b];
+		if (seen > rank)
+			return Stats::bucketFloor(b);
+	}
+	return 0;
+}
+
+/**
+ * Prints the counters and the per-stage latencies recorded so far by every thread.
+ *
+ * @param out The stream to print to.
+ */
+void Stats::dump(std::ostream& out)
+{
+#ifndef BTC_STATS
+	out << BYEL "⚠️  Statistics are not compiled in (rebuild with make re STATS=1)." RESET << std::endl;
+	return;
+#endif
+	Record total;
+	pthread_mutex_lock(&g_lock);
+	total.add(g_finished);
+	pthread_mutex_unlock(&g_lock);
+	total.add(localRecord());
+
+	out << "\n" BCYN "📈 Counters" RESET "\n";
+	for (size_t c = 0; c < COUNTER_COUNT; c++)
+		out << "  " << std::left << std::setw(24) << g_counterNames[c] << std::right
+			<< std::setw(12) << total.counters[c] << "\n";
+
+	out << "\n" BCYN "⏱️  Stages" RESET "  (ns; percentiles are histogram bucket floors)\n"
+		<< "  " << std::left << std::setw(16) << "stage" << std::right
+		<< std::setw(12) << "calls" << std::setw(14) << "total ms" << std::setw(10) << "mean"
+		<< std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+		<< std::setw(12) << "max" << "\n";
+	for (size_t s = 0; s < STAGE_COUNT; s++)
+	{
+		uint64_t calls = total.calls[s];
+		if (calls == 0)
+			continue;
+		out << "  " << std::left << std::setw(16) << g_stageNames[s] << std::right
+			<< std::setw(12) << calls
+			<< std::setw(14) << std::fixed << std::setprecision(3)
+			<< static_cast<double>(total.totalNs[s]) / 1e6
+			<< std::setw(10) << total.totalNs[s] / calls
+			<< std::setw(10) << percentile(total.histogram[s], calls, 0.50)
+			<< std::setw(10) << percentile(total.histogram[s], calls, 0.90)
+			<< std::setw(10) << percentile(total.histogram[s], calls, 0.99)
+			<< std::setw(12) << total.maxNs[s] << "\n";
+	}
+	out << std::flush;
+}
+
+/**
+ * Starts timing a stage.
+ */
+Stats::Timer::Timer(Stage stage) : _stage(stage), _start(now()), _running(true) {}
+
+/**
+ * Records the stage if it was not stopped explicitly.
+ */
+Stats::Timer::~Timer()
+{
+	stop();
+}
+
+/**
+ * Records the time elapsed since construction. Later calls do nothing.
+ */
+void Stats::Timer::stop()
+{
+	if (!_running)
+		return;
+	_running = false;
+	record(_stage, now() - _start);
+}
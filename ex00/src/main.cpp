@@ -11,8 +11,12 @@
 /* ************************************************************************** */
 
 #include <iostream>
+#include <iomanip>
+#include <unistd.h>
+#include <cstdlib>
 #include "../inc/ansi.h"
 #include "../inc/BitCoinExchange.hpp"
+#include "../inc/ExchangeServer.hpp"
 
 #define SEPARATOR(txt) std::cout << "\n"                                              \
 								<< BWHT "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"     \
@@ -20,29 +24,233 @@
 								<< "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" RESET "\n" \
 								<< std::endl;
 
+/**
+ * Optional flags, as a bit set, so that each mode can list the ones it uses.
+ * --color and --no-color are not listed: every mode prints colored messages.
+ */
+enum Flag
+{
+	FLAG_STREAM = 1 << 0,
+	FLAG_THREADS = 1 << 1,
+	FLAG_SNAPSHOT = 1 << 2,
+	FLAG_DENSE = 1 << 3,
+	FLAG_EXACT = 1 << 4,
+	FLAG_CACHE = 1 << 5,
+	FLAG_COMPRESSED = 1 << 6,
+	FLAG_STATS = 1 << 7
+};
+
+/**
+ * Prints the aggregates of a date range.
+ *
+ * @param summary The aggregates to print.
+ * @param colors Whether to color the title line, as decided for the result lines.
+ */
+static void printSummary(const RangeTable::Summary& summary, bool colors)
+{
+	std::cout << (colors ? BCYN : "") << "📈 " << Date::format(summary.firstDay) << " → " << Date::format(summary.lastDay)
+			  << ": " << summary.rates << " rate" << (summary.rates > 1 ? "s" : "") << " in effect"
+			  << (colors ? RESET : "") << "\n"
+			  << std::fixed << std::setprecision(2)
+			  << "   min            " << summary.min << "\n"
+			  << "   max            " << summary.max << "\n"
+			  << "   mean           " << summary.mean << "\n"
+			  << "   time-weighted  " << summary.timeWeighted << std::endl;
+}
+
 // ─────────────────────────────────────────────────────────────
 // 🚀 main()
 // ─────────────────────────────────────────────────────────────
 
 int main(int argc, char **argv)
 {
-	std::cout << BGRN "\n\n📋===== BITCOIN EXCHANGE SIMULATION =====📋\n\n" RESET;
+	bool stream = false;
+	bool snapshot = false;
+	bool dense = false;
+	bool stats = false;
+	bool exact = false;
+	bool cache = false;
+	bool compressed = false;
+	int colors = -1;
+	long threads = 1;
+	bool threaded = false;
+	const char* input = NULL;
+	const char* serve = NULL;
+	const char* rangeFrom = NULL;
+	const char* rangeTo = NULL;
+	const char* columnsIn = NULL;
+	const char* columnsOut = NULL;
+	bool toColumns = false;
+	std::vector<std::string> assets;
+	bool valid = true;
 
-	if (argc != 2)
+	for (int i = 1; i < argc; i++)
 	{
-		std::cout << BRED "❌ Error: Invalid number of arguments." RESET
-				<< "Usage: ./btc <input_file>" << std::endl;
+		std::string arg = argv[i];
+		if (arg == "--stream")
+			stream = true;
+		else if (arg == "--snapshot")
+			snapshot = true;
+		else if (arg == "--dense")
+			dense = true;
+		else if (arg == "--stats")
+			stats = true;
+		else if (arg == "--exact")
+			exact = true;
+		else if (arg == "--cache")
+			cache = true;
+		else if (arg == "--compressed")
+			compressed = true;
+		else if (arg == "--color" || arg == "--no-color")
+			colors = arg == "--color";
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			char *endptr;
+			threads = std::strtol(argv[++i], &endptr, 10);
+			if (*endptr != '\0' || threads < 1 || threads > 1024)
+				valid = false;
+			stream = true;
+			threaded = true;
+		}
+		else if (arg == "--assets" && i + 1 < argc)
+			assets.push_back(argv[++i]);
+		else if (arg == "--serve" && i + 1 < argc)
+			serve = argv[++i];
+		else if (arg == "--range" && i + 2 < argc)
+		{
+			rangeFrom = argv[++i];
+			rangeTo = argv[++i];
+		}
+		else if ((arg == "--columns" || arg == "--to-columns") && i + 2 < argc)
+		{
+			toColumns = (arg == "--to-columns");
+			columnsIn = argv[++i];
+			columnsOut = argv[++i];
+		}
+		else if (!input && arg.compare(0, 2, "--") != 0)
+			input = argv[i];
+		else
+			valid = false;
+	}
+	valid = valid && (input != NULL) + (serve != NULL) + (rangeFrom != NULL) + (columnsIn != NULL) == 1
+		&& (assets.empty() || input != NULL);
+
+	// Every mode rejects the flags it would ignore
+	unsigned flags = (stream && !threaded ? FLAG_STREAM : 0) | (threaded ? FLAG_THREADS : 0)
+		| (snapshot ? FLAG_SNAPSHOT : 0) | (dense ? FLAG_DENSE : 0) | (exact ? FLAG_EXACT : 0)
+		| (cache ? FLAG_CACHE : 0) | (compressed ? FLAG_COMPRESSED : 0) | (stats ? FLAG_STATS : 0);
+	unsigned allowed = ~0u;
+	if (serve)
+		allowed = FLAG_SNAPSHOT | FLAG_DENSE | FLAG_EXACT | FLAG_COMPRESSED | FLAG_STATS;
+	else if (!assets.empty())
+		allowed = FLAG_EXACT | FLAG_STATS;
+	else if (rangeFrom)
+		allowed = FLAG_SNAPSHOT | FLAG_STATS;
+	else if (columnsIn && toColumns)
+		allowed = 0;
+	else if (columnsIn)
+		allowed = FLAG_SNAPSHOT | FLAG_COMPRESSED | FLAG_STATS;
+	valid = valid && (flags & ~allowed) == 0;
+
+	// Errors go to stderr, which gets colors only if it is a terminal itself
+	bool errorColors = (colors < 0) ? isatty(STDERR_FILENO) != 0 : colors != 0;
+
+	// Without a flag, lines are colored only for a terminal; socket clients never get colors
+	if (colors < 0)
+		colors = isatty(STDOUT_FILENO) && (!serve || std::string(serve) == "-");
+
+	// Responses on stdout must not be preceded by the banner
+	if (!serve || std::string(serve) != "-")
+		std::cout << (colors ? BGRN : "") << "\n\n📋===== BITCOIN EXCHANGE SIMULATION =====📋\n\n"
+				  << (colors ? RESET : "");
+
+	if (!valid)
+	{
+		std::cerr << (errorColors ? BRED : "") << "❌ Error: Invalid number of arguments."
+				<< (errorColors ? RESET : "") << "\n"
+				<< "Usage: ./btc [--stream] [--threads N] [--snapshot] [--dense] [--exact] [--cache] [--compressed]\n"
+				<< "             [--stats] [--color | --no-color] <input_file>\n"
+				<< "       ./btc [--snapshot] [--dense] [--exact] [--compressed] [--stats] [--color | --no-color]\n"
+				<< "             --serve <socket_path | ->\n"
+				<< "       ./btc [--exact] [--stats] [--color | --no-color] --assets <rates_file> [--assets ...]\n"
+				<< "             <input_file>\n"
+				<< "       ./btc [--snapshot] [--stats] [--color | --no-color] --range <from_date> <to_date>\n"
+				<< "       ./btc [--snapshot] [--compressed] [--stats] [--color | --no-color]\n"
+				<< "             --columns <queries.col> <results.col>\n"
+				<< "       ./btc [--color | --no-color] --to-columns <input_file> <queries.col>" << std::endl;
 		return 1;
 	}
 
 	BitCoinExchange exchange;
+	int status = 0;
+	exchange.useDenseTable(dense);
+	exchange.useExactArithmetic(exact);
+	exchange.useColors(colors != 0);
+	exchange.useDateCache(cache);
+	exchange.useCompressedHistory(compressed);
 	try {
-		exchange.loadDatabase("data.csv");
-		exchange.processInputFile(argv[1]);
+		// Converting queries to columns needs no rates
+		if (!assets.empty())
+			exchange.loadAssets(assets);
+		else if (columnsIn && toColumns)
+			;
+		else if (snapshot)
+			exchange.loadCachedDatabase("data.csv");
+		else
+			exchange.loadDatabase("data.csv");
+		if (serve)
+		{
+			ExchangeServer server(exchange, "data.csv");
+			if (std::string(serve) == "-")
+				server.serveStdio();
+			else
+			{
+				std::cout << (colors ? BCYN : "") << "🔌 Listening on " << serve << (colors ? RESET : "") << std::endl;
+				server.serveSocket(serve);
+			}
+		}
+		else if (!assets.empty())
+		{
+			std::cout << std::flush;
+			OutputBuffer out(STDOUT_FILENO);
+			exchange.processAssetFile(input, out);
+		}
+		else if (columnsIn && toColumns)
+		{
+			size_t skipped;
+			size_t rows = exchange.convertInputFile(columnsIn, columnsOut, skipped);
+			std::cout << (colors ? BCYN : "") << "🔁 Wrote " << rows << " queries to " << columnsOut << " ("
+					  << skipped << " lines skipped)" << (colors ? RESET : "") << std::endl;
+		}
+		else if (columnsIn)
+		{
+			size_t rows = exchange.valueColumnFile(columnsIn, columnsOut);
+			std::cout << (colors ? BCYN : "") << "🔁 Wrote " << rows << " results to " << columnsOut
+					  << (colors ? RESET : "") << std::endl;
+		}
+		else if (rangeFrom)
+		{
+			RangeTable::Summary summary;
+			if (!exchange.summarizeRange(rangeFrom, rangeTo, summary))
+				throw std::runtime_error("no data available for this range.");
+			printSummary(summary, colors != 0);
+		}
+		else if (stream)
+		{
+			std::cout << std::flush;
+			OutputBuffer out(STDOUT_FILENO);
+			exchange.streamInputFile(input, out, static_cast<size_t>(threads));
+		}
+		else
+			exchange.processInputFile(input);
 	} catch (const std::exception& e) {
-		std::cerr << BRED "❌ Error: " << e.what() << RESET << std::endl;
-		return 1;
+		std::cerr << (errorColors ? BRED : "") << "❌ Error: " << e.what() << (errorColors ? RESET : "")
+				  << std::endl;
+		status = 1;
 	}
 
-	return 0;
+	// Statistics go to stderr so that stdout stays identical
+	if (stats)
+		Stats::dump(std::cerr);
+	return status;
 }
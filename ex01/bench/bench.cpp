@@ -0,0 +1,345 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/18 10:02:54 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/18 10:02:54 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdlib>
+#include <new>
+#include <climits>
+#include "../inc/ansi.h"
+#include "../inc/RPN.hpp"
+
+#define EXPRESSION_COUNT 200000
+#define OPERANDS 12
+#define PROGRAM_COUNT 1000
+#define REPEATS 200
+#define CHECK_COUNT 20000
+
+// ─────────────────────────────────────────────────────────────
+// 🧮 allocation counter
+// ─────────────────────────────────────────────────────────────
+
+static size_t g_allocations = 0;
+
+/**
+ * Counts every allocation of the program. The default operator delete releases with free, so
+ * it is left alone.
+ */
+void *operator new(size_t size) throw (std::bad_alloc)
+{
+	g_allocations++;
+	void *p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🧰 helpers
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Builds random expressions of OPERANDS single digits, with each operator placed as soon as the
+ * stack allows it or later, at random. When invalid is set, one token of each expression is
+ * replaced by a letter, so that every expression fails.
+ */
+static void makeExpressions(std::vector<std::string>& expressions, bool invalid)
+{
+	static const char operators[] = "+-*/";
+
+	expressions.resize(EXPRESSION_COUNT);
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		std::string& text = expressions[i];
+		int depth = 0;
+		int pushed = 0;
+		while (pushed < OPERANDS || depth > 1)
+		{
+			if (!text.empty())
+				text += ' ';
+			if (depth >= 2 && (pushed == OPERANDS || std::rand() % 2))
+			{
+				text += operators[std::rand() % 4];
+				depth--;
+			}
+			else
+			{
+				text += static_cast<char>('1' + std::rand() % 9);
+				depth++;
+				pushed++;
+			}
+		}
+		if (invalid)
+			text[(std::rand() % (text.size() / 2)) * 2] = 'x';
+	}
+}
+
+/**
+ * Builds a random expression over the variables a, b and c and a few constants, with up to 40
+ * operands and operators deferred as long as possible half of the time, so that stack depths go
+ * well past the registers of NativeProgram.
+ */
+static std::string makeDeepExpression()
+{
+	static const char operators[] = "+-*/";
+	static const char* operands[] = { "a", "b", "c", "0", "1", "7", "-1", "2147483647", "-2147483648" };
+
+	std::string text;
+	int operandCount = 1 + std::rand() % 40;
+	bool deep = std::rand() % 2;
+	int depth = 0;
+	int pushed = 0;
+	while (pushed < operandCount || depth > 1)
+	{
+		if (!text.empty())
+			text += ' ';
+		if (depth >= 2 && (pushed == operandCount || std::rand() % (deep ? 8 : 2) == 0))
+		{
+			text += operators[std::rand() % 4];
+			depth--;
+		}
+		else
+		{
+			text += operands[std::rand() % 9];
+			depth++;
+			pushed++;
+		}
+	}
+	return text;
+}
+
+/**
+ * Checks that native programs give the results and statuses of the interpreter, on deep
+ * expressions and on the edge values of int arithmetic.
+ */
+static bool sameResults()
+{
+	static const int values[] = { 0, 1, -1, 3, -7, INT_MAX, INT_MIN, 123456789 };
+
+	for (size_t i = 0; i < CHECK_COUNT; i++)
+	{
+		Program program = RPN::compile(makeDeepExpression());
+		NativeProgram native(program);
+		for (int k = 0; k < 8; k++)
+		{
+			int variables[3] = { values[std::rand() % 8], values[std::rand() % 8], values[std::rand() % 8] };
+			int expected = 0;
+			int actual = 0;
+			Program::Status want = program.run(variables, expected);
+			Program::Status got = native.run(variables, actual);
+			if (want != got || (want == Program::STATUS_OK && expected != actual))
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Prints one benchmark line in nanoseconds per expression and expressions per second, with the
+ * heap allocations made per expression.
+ */
+static void report(const char* label, clock_t start, clock_t end, size_t allocations, long long checksum)
+{
+	double seconds = static_cast<double>(end - start) / CLOCKS_PER_SEC;
+	std::cout << BCYN << std::left << std::setw(34) << label << RESET
+			  << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(9) << seconds * 1e9 / EXPRESSION_COUNT << " ns/expr"
+			  << std::setprecision(2) << std::setw(8) << EXPRESSION_COUNT / seconds / 1e6 << " M expr/s"
+			  << std::setw(7) << static_cast<double>(allocations) / EXPRESSION_COUNT << " allocs/expr"
+			  << HBLK "  (checksum " << checksum << ")" RESET << std::endl;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 📊 benchmarks
+// ─────────────────────────────────────────────────────────────
+
+static long long benchThrowing(const std::vector<std::string>& expressions, std::vector<int>& results)
+{
+	RPN rpn;
+	long long sum = 0;
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		try {
+			results[i] = rpn.evaluate(expressions[i]);
+			sum += results[i];
+		} catch (const std::exception&) {
+			results[i] = 0;
+			sum--;
+		}
+	}
+	return sum;
+}
+
+static long long benchStatus(const std::vector<std::string>& expressions, std::vector<int>& results)
+{
+	long long sum = 0;
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		const char *text = expressions[i].data();
+		if (RPN::evaluate(text, text + expressions[i].size(), results[i]) == RPN::STATUS_OK)
+			sum += results[i];
+		else
+		{
+			results[i] = 0;
+			sum--;
+		}
+	}
+	return sum;
+}
+
+static long long benchCompiled(const std::vector<std::string>& expressions)
+{
+	long long sum = 0;
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		int result;
+		try {
+			Program program = RPN::compile(expressions[i]);
+			if (program.run(result) == Program::STATUS_OK)
+				sum += result;
+			else
+				sum--;
+		} catch (const std::exception&) {
+			sum--;
+		}
+	}
+	return sum;
+}
+
+/**
+ * Times the three evaluators over one set of expressions, and checks that the two evaluate
+ * overloads agree on every result.
+ */
+static bool benchSet(const char* title, const std::vector<std::string>& expressions)
+{
+	std::vector<int> thrown(expressions.size());
+	std::vector<int> returned(expressions.size());
+
+	std::cout << BGRN "\n📊 " << title << "\n" RESET << std::endl;
+
+	size_t allocations = g_allocations;
+	clock_t start = clock();
+	long long sum = benchThrowing(expressions, thrown);
+	report("RPN::evaluate (exceptions)", start, clock(), g_allocations - allocations, sum);
+
+	allocations = g_allocations;
+	start = clock();
+	sum = benchStatus(expressions, returned);
+	report("RPN::evaluate (status, no alloc)", start, clock(), g_allocations - allocations, sum);
+
+	allocations = g_allocations;
+	start = clock();
+	sum = benchCompiled(expressions);
+	report("RPN::compile + Program::run", start, clock(), g_allocations - allocations, sum);
+
+	if (thrown != returned)
+	{
+		std::cerr << BRED "❌ Error: the evaluate overloads disagree." RESET << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Times compiled-once programs against evaluating the text of their expressions, over
+ * PROGRAM_COUNT expressions run REPEATS times each.
+ */
+static void benchPrograms(const std::vector<std::string>& expressions)
+{
+	std::vector<Program> programs;
+	std::vector<NativeProgram> natives;
+	for (size_t i = 0; i < PROGRAM_COUNT; i++)
+	{
+		programs.push_back(RPN::compile(expressions[i]));
+		natives.push_back(NativeProgram(programs.back()));
+	}
+
+	std::cout << BGRN "\n📊 Compiled once, run " << REPEATS << " times ("
+			  << (natives[0].native() ? "native code" : "no native code, interpreted") << ")\n" RESET << std::endl;
+
+	RPN rpn;
+	long long sum = 0;
+	size_t allocations = g_allocations;
+	clock_t start = clock();
+	for (size_t r = 0; r < REPEATS; r++)
+		for (size_t i = 0; i < PROGRAM_COUNT; i++)
+		{
+			try {
+				sum += rpn.evaluate(expressions[i]);
+			} catch (const std::exception&) {
+				sum--;
+			}
+		}
+	report("RPN::evaluate (exceptions)", start, clock(), g_allocations - allocations, sum);
+
+	sum = 0;
+	allocations = g_allocations;
+	start = clock();
+	for (size_t r = 0; r < REPEATS; r++)
+		for (size_t i = 0; i < PROGRAM_COUNT; i++)
+		{
+			int result;
+			const char *text = expressions[i].data();
+			sum += (RPN::evaluate(text, text + expressions[i].size(), result) == RPN::STATUS_OK) ? result : -1;
+		}
+	report("RPN::evaluate (status, no alloc)", start, clock(), g_allocations - allocations, sum);
+
+	sum = 0;
+	allocations = g_allocations;
+	start = clock();
+	for (size_t r = 0; r < REPEATS; r++)
+		for (size_t i = 0; i < PROGRAM_COUNT; i++)
+		{
+			int result;
+			sum += (programs[i].run(result) == Program::STATUS_OK) ? result : -1;
+		}
+	report("Program::run", start, clock(), g_allocations - allocations, sum);
+
+	sum = 0;
+	allocations = g_allocations;
+	start = clock();
+	for (size_t r = 0; r < REPEATS; r++)
+		for (size_t i = 0; i < PROGRAM_COUNT; i++)
+		{
+			int result;
+			sum += (natives[i].run(result) == Program::STATUS_OK) ? result : -1;
+		}
+	report("NativeProgram::run", start, clock(), g_allocations - allocations, sum);
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🚀 main()
+// ─────────────────────────────────────────────────────────────
+
+int main()
+{
+	std::vector<std::string> valid;
+	std::vector<std::string> invalid;
+
+	std::srand(42);
+	makeExpressions(valid, false);
+	makeExpressions(invalid, true);
+
+	if (!benchSet("Valid expressions", valid) || !benchSet("Invalid expressions", invalid))
+		return 1;
+
+	if (!sameResults())
+	{
+		std::cerr << BRED "❌ Error: native programs disagree with the interpreter." RESET << std::endl;
+		return 1;
+	}
+	benchPrograms(valid);
+	return 0;
+}
@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Arithmetic.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/18 09:41:07 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/18 09:41:07 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+/**
+ * Integer arithmetic shared by the evaluators that report errors as statuses.
+ *
+ * Operations are done on the two's complement representation, so that overflows wrap around
+ * instead of being undefined, and every evaluator gives the same result for the same
+ * expression.
+ */
+namespace Arithmetic
+{
+	inline int add(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) + static_cast<unsigned int>(b));
+	}
+
+	inline int sub(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) - static_cast<unsigned int>(b));
+	}
+
+	inline int mul(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) * static_cast<unsigned int>(b));
+	}
+
+	/**
+	 * Divides two ints, with INT_MIN / -1 wrapping around like the other operators. The
+	 * divisor must not be zero.
+	 */
+	inline int div(int a, int b)
+	{
+		return (b == -1) ? sub(0, a) : a / b;
+	}
+}
@@ -0,0 +1,48 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LineReader.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/19 11:40:12 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/19 11:40:12 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Block-buffered reader of whole lines from a file descriptor.
+ *
+ * Input is read with large read(2) calls into a single buffer, and handed out
+ * as blocks of complete lines that stay valid until the next call: a line is
+ * never split across two blocks. The partial line at the end of a read is
+ * kept for the next block, and the buffer grows when one line does not fit.
+ * Works the same on files, pipes and terminals.
+ */
+class LineReader
+{
+	public:
+		static const size_t CAPACITY = 1 << 20;
+
+		explicit LineReader(int fd);
+		~LineReader();
+
+		bool nextBlock(const char *&begin, const char *&end);
+
+	private:
+		int _fd;
+		std::vector<char> _buffer;
+		size_t _start;
+		size_t _used;
+		bool _eof;
+
+		LineReader(const LineReader &other);
+		LineReader &operator=(const LineReader &other);
+
+		size_t fill();
+};
@@ -0,0 +1,66 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   NativeProgram.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/22 09:15:40 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/22 09:15:40 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "Program.hpp"
+
+/**
+ * Program translated to x86-64 machine code, built by RPN::compileNative.
+ *
+ * The instructions of a compiled Program are assembled once into a function
+ * of the form `Status f(const int *values, int *result)`, placed in its own
+ * mapped page, which is made executable only after it was written. There is
+ * no dispatch left at run time: the operand stack is resolved at assembly
+ * time, its first REGISTERS levels living in registers and the deeper ones
+ * in a frame on the machine stack. Results are those of Program::run,
+ * statuses included.
+ *
+ * When native code cannot be produced (another architecture, a system
+ * refusing executable mappings, or a program whose deeper levels would need a
+ * frame larger than MAX_FRAME bytes), run() falls back to interpreting the
+ * program, so callers never need to check native(). The bound keeps the frame
+ * well within a page: it fits the small stacks of threads, and it cannot
+ * step over the guard page below the stack.
+ */
+class NativeProgram
+{
+	public:
+		static const size_t REGISTERS = 9;
+		static const size_t MAX_FRAME = 2048;
+
+		NativeProgram();
+		explicit NativeProgram(const Program &program);
+		NativeProgram(const NativeProgram &other);
+		~NativeProgram();
+		NativeProgram &operator=(const NativeProgram &other);
+
+		Program::Status run(int &result);
+		Program::Status run(const int *values, int &result);
+		bool native() const;
+		const Program &program() const;
+
+	private:
+		typedef int (*Function)(const int *values, int *result);
+
+		Program _program;
+		void *_page;
+		size_t _pageSize;
+		Function _function;
+
+		void assemble();
+		void release();
+		static void emitCode(const Program &program, std::vector<uint8_t> &code);
+};
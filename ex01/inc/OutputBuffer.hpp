@@ -0,0 +1,88 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputBuffer.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/19 11:26:48 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/19 11:26:48 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * Block-buffered writer on top of a file descriptor.
+ *
+ * Text is accumulated in a fixed buffer and handed to write(2) only when the
+ * buffer is full or flush() is called, so thousands of result lines cost a
+ * single system call. The buffer is flushed on destruction.
+ *
+ * A buffer can also spill into a memory sink instead of a file descriptor,
+ * which lets worker threads format their share of the output independently
+ * and hand it over to be written in order.
+ */
+class OutputBuffer
+{
+	public:
+		static const size_t CAPACITY = 1 << 16;
+
+		explicit OutputBuffer(int fd);
+		explicit OutputBuffer(std::vector<char>& sink);
+		~OutputBuffer();
+
+		void append(const char* data, size_t len);
+		void append(const char* str);
+		void append(char c);
+		void flush();
+
+		int fd() const;
+
+	private:
+		int _fd;
+		std::vector<char>* _sink;
+		size_t _used;
+		char _buffer[CAPACITY];
+
+		OutputBuffer(const OutputBuffer& other);
+		OutputBuffer& operator=(const OutputBuffer& other);
+
+		void writeAll(const char* data, size_t len);
+};
+
+/**
+ * Appends a range of bytes, flushing first if they do not fit.
+ *
+ * Defined inline because it runs several times per output line.
+ */
+inline void OutputBuffer::append(const char* data, size_t len)
+{
+	if (_used + len > CAPACITY)
+	{
+		flush();
+		if (len > CAPACITY)
+		{
+			writeAll(data, len);
+			return;
+		}
+	}
+	std::memcpy(_buffer + _used, data, len);
+	_used += len;
+}
+
+inline void OutputBuffer::append(const char* str)
+{
+	append(str, std::strlen(str));
+}
+
+inline void OutputBuffer::append(char c)
+{
+	if (_used == CAPACITY)
+		flush();
+	_buffer[_used++] = c;
+}
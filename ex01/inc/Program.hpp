@@ -0,0 +1,94 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Program.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/16 10:12:31 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/16 10:12:31 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Compiled form of an RPN expression, built by RPN::compile.
+ *
+ * Each instruction is a 32-bit word: an opcode in the low byte and, for
+ * OP_PUSH and OP_LOAD, the index of its operand in the upper bits: a constant
+ * of the constant pool, or a variable. The compiler has already checked the
+ * tokens and the stack depth at every step, so run() only has to dispatch
+ * opcodes over a stack sized for the deepest point of the expression; the
+ * only error left at run time is a division by zero, reported as a status.
+ * Arithmetic wraps around on overflow.
+ *
+ * runColumns() evaluates the program over columns of variable values, one
+ * block of BATCH_ROWS rows at a time: each instruction becomes a loop over a
+ * whole block of the stack, which the compiler can vectorize, instead of one
+ * dispatch per row.
+ *
+ * Both use scratch stacks owned by the program, so a program is not shared
+ * between threads. The stacks are allocated on first use and are not copied,
+ * so copies stay cheap and independent.
+ */
+class Program
+{
+	public:
+		enum Opcode
+		{
+			OP_PUSH,
+			OP_LOAD,
+			OP_ADD,
+			OP_SUB,
+			OP_MUL,
+			OP_DIV
+		};
+
+		enum Status
+		{
+			STATUS_OK,
+			STATUS_DIVISION_BY_ZERO,
+			STATUS_EMPTY,
+			STATUS_UNBOUND_VARIABLE
+		};
+
+		static const size_t MAX_CONSTANTS = 1 << 24;
+		static const size_t BATCH_ROWS = 256;
+
+		Program();
+		Program(const Program &other);
+		~Program();
+		Program &operator=(const Program &other);
+
+		void emit(Opcode op);
+		void emitPush(int value);
+		void emitLoad(const std::string &name);
+		void finish(size_t maxDepth);
+
+		Status run(int &result);
+		Status run(const int *values, int &result);
+		size_t runColumns(const int *const *columns, size_t rows, int *results, uint8_t *status);
+		size_t size() const;
+		uint32_t instruction(size_t index) const;
+		int constant(size_t index) const;
+		size_t maxDepth() const;
+		size_t variables() const;
+		const std::string &variable(size_t index) const;
+
+	private:
+		std::vector<uint32_t> _code;
+		std::vector<int> _constants;
+		std::vector<std::string> _variables;
+		std::vector<int> _stack;
+		std::vector<int> _blocks;
+		std::vector<const int *> _slots;
+		std::vector<int> _tail;
+		std::vector<const int *> _tailColumns;
+		size_t _maxDepth;
+};
@@ -13,22 +13,49 @@
 #pragma once
 
 #include <stack>
+#include <cstddef>
 #include <string>
 #include <stdexcept>
 #include <sstream>
+#include "Program.hpp"
+#include "NativeProgram.hpp"
+#include "OutputBuffer.hpp"
 
 class RPN
 {
 	public:
+		enum Status
+		{
+			STATUS_OK,
+			STATUS_NOT_ENOUGH_OPERANDS,
+			STATUS_INVALID_TOKEN,
+			STATUS_INVALID_EXPRESSION,
+			STATUS_DIVISION_BY_ZERO,
+			STATUS_STACK_OVERFLOW
+		};
+
+		static const size_t STACK_CAPACITY = 256;
+
 		RPN();
 		RPN(const RPN &other);
 		~RPN();
 		RPN &operator=(const RPN &other);
 
 		int evaluate(const std::string &expression);
+		static Status evaluate(const char *begin, const char *end, int &result, const char **where = NULL);
+		static const char *message(Status status);
+		static size_t evaluateLines(const char *begin, const char *end, OutputBuffer &out);
+		static size_t evaluateStream(int fd, OutputBuffer &out, size_t threads);
+		static Program compile(const std::string &expression);
+		static NativeProgram compileNative(const std::string &expression);
 	private:
 		std::stack<int> _stack;
 
 		void processToken(const std::string &token);
 		bool isNumber(const std::string &token) const;
+		static bool isOperator(const char *begin, const char *end, Program::Opcode &op);
+		static bool parseNumber(const char *begin, const char *end, int &value);
+		static bool isName(const char *begin, const char *end);
+		static size_t evaluateParallel(int fd, OutputBuffer &out, size_t threads);
+		static void *evaluateChunks(void *arg);
 };
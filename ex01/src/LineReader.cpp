@@ -0,0 +1,103 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LineReader.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/19 11:40:12 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/19 11:40:12 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/LineReader.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+/**
+ * Constructor
+ *
+ * @param fd The file descriptor to read from. It is not closed.
+ */
+LineReader::LineReader(int fd) : _fd(fd), _buffer(CAPACITY), _start(0), _used(0), _eof(false) {}
+
+/**
+ * Destructor
+ */
+LineReader::~LineReader() {}
+
+/**
+ * Returns the next block of whole lines.
+ *
+ * The block ends right after its last newline, or at the end of the input for a last line
+ * without one. It points into the reader's buffer and stays valid until the next call.
+ *
+ * @param begin Receives the first character of the block.
+ * @param end Receives one past its last character.
+ * @return false once the input is exhausted.
+ * @throw std::runtime_error if read(2) fails.
+ */
+bool LineReader::nextBlock(const char *&begin, const char *&end)
+{
+	size_t scanned = _start;
+	for (;;)
+	{
+		const char *data = &_buffer[0];
+		for (size_t i = _used; i > scanned; i--)
+		{
+			if (data[i - 1] == '\n')
+			{
+				begin = data + _start;
+				end = data + i;
+				_start = i;
+				return true;
+			}
+		}
+		if (_eof)
+		{
+			if (_start == _used)
+				return false;
+			begin = data + _start;
+			end = data + _used;
+			_start = _used;
+			return true;
+		}
+		scanned = _used - _start;
+		if (fill() == 0)
+			_eof = true;
+		scanned += _start;
+	}
+}
+
+/**
+ * Moves the unconsumed bytes to the front of the buffer, growing it if they fill it, and reads
+ * once into the room left.
+ *
+ * @return The number of bytes read, 0 at the end of the input.
+ * @throw std::runtime_error if read(2) fails.
+ */
+size_t LineReader::fill()
+{
+	if (_start > 0)
+	{
+		std::memmove(&_buffer[0], &_buffer[_start], _used - _start);
+		_used -= _start;
+		_start = 0;
+	}
+	if (_used == _buffer.size())
+		_buffer.resize(_buffer.size() * 2);
+
+	for (;;)
+	{
+		ssize_t received = ::read(_fd, &_buffer[_used], _buffer.size() - _used);
+		if (received < 0)
+		{
+			if (errno == EINTR) continue;
+			throw std::runtime_error("could not read input.");
+		}
+		_used += static_cast<size_t>(received);
+		return static_cast<size_t>(received);
+	}
+}
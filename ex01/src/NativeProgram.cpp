@@ -0,0 +1,410 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   NativeProgram.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/22 09:15:40 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/22 09:15:40 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/NativeProgram.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const size_t NativeProgram::REGISTERS;
+const size_t NativeProgram::MAX_FRAME;
+
+/**
+ * x86-64 register numbers holding the stack levels kept in registers, shallowest first. The
+ * first four are scratch registers of the System V calling convention; the others must be
+ * saved by the function, so they are only used by deep programs. eax, ecx and edx are left
+ * free for division, rdi and rsi hold the arguments.
+ */
+static const int g_registers[NativeProgram::REGISTERS] = { 8, 9, 10, 11, 3, 12, 13, 14, 15 };
+static const size_t SCRATCH_REGISTERS = 4;
+
+static const int EAX = 0;
+static const int ECX = 1;
+
+// ─────────────────────────────────────────────────────────────
+// 🧰 encoding helpers
+// ─────────────────────────────────────────────────────────────
+
+static void emitDword(std::vector<uint8_t> &code, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+/**
+ * Emits an instruction whose r/m operand is a stack level: the register of that level, or its
+ * slot in the frame, addressed from rsp.
+ *
+ * @param code The code to append to.
+ * @param opcode The opcode bytes.
+ * @param length The number of opcode bytes.
+ * @param reg The register number, or opcode extension, of the ModRM reg field.
+ * @param depth The stack level.
+ */
+static void emitLevel(std::vector<uint8_t> &code, const uint8_t *opcode, size_t length, int reg, size_t depth)
+{
+	if (depth < NativeProgram::REGISTERS)
+	{
+		int rm = g_registers[depth];
+		if (reg >= 8 || rm >= 8)
+			code.push_back(static_cast<uint8_t>(0x40 | (reg >> 3) << 2 | rm >> 3));
+		code.insert(code.end(), opcode, opcode + length);
+		code.push_back(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7)));
+		return;
+	}
+	if (reg >= 8)
+		code.push_back(0x44);
+	code.insert(code.end(), opcode, opcode + length);
+	code.push_back(static_cast<uint8_t>(0x84 | (reg & 7) << 3));
+	code.push_back(0x24);
+	emitDword(code, static_cast<uint32_t>(4 * (depth - NativeProgram::REGISTERS)));
+}
+
+static void emitLoad(std::vector<uint8_t> &code, int reg, size_t depth)
+{
+	static const uint8_t op[] = { 0x8B };
+	emitLevel(code, op, sizeof(op), reg, depth);
+}
+
+static void emitStore(std::vector<uint8_t> &code, int reg, size_t depth)
+{
+	static const uint8_t op[] = { 0x89 };
+	emitLevel(code, op, sizeof(op), reg, depth);
+}
+
+/**
+ * Applies a binary operator to two adjacent stack levels, leaving the result in the lower one.
+ * A level held in a register is operated on in place; otherwise eax is used.
+ */
+static void emitArithmetic(std::vector<uint8_t> &code, const uint8_t *opcode, size_t length, size_t depth)
+{
+	size_t left = depth - 2;
+	if (left < NativeProgram::REGISTERS)
+	{
+		emitLevel(code, opcode, length, g_registers[left], depth - 1);
+		return;
+	}
+	emitLoad(code, EAX, left);
+	emitLevel(code, opcode, length, EAX, depth - 1);
+	emitStore(code, EAX, left);
+}
+
+static void patchRel32(std::vector<uint8_t> &code, size_t at, size_t target)
+{
+	uint32_t rel = static_cast<uint32_t>(target - (at + 4));
+	for (int i = 0; i < 4; i++)
+		code[at + i] = static_cast<uint8_t>(rel >> (8 * i));
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🏗️ orthodox canonical form
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty program, which run() rejects.
+ */
+NativeProgram::NativeProgram() : _page(NULL), _pageSize(0), _function(NULL) {}
+
+/**
+ * Constructor
+ *
+ * @param program The compiled program to translate.
+ */
+NativeProgram::NativeProgram(const Program &program)
+	: _program(program), _page(NULL), _pageSize(0), _function(NULL)
+{
+	assemble();
+}
+
+/**
+ * Copy constructor
+ *
+ * The copy assembles its own code page.
+ *
+ * @param other The program to copy from.
+ */
+NativeProgram::NativeProgram(const NativeProgram &other)
+	: _program(other._program), _page(NULL), _pageSize(0), _function(NULL)
+{
+	assemble();
+}
+
+/**
+ * Destructor
+ *
+ * Unmaps the code page.
+ */
+NativeProgram::~NativeProgram()
+{
+	release();
+}
+
+/**
+ * Assignment operator
+ *
+ * @param other The program to assign from.
+ * @return A reference to this program.
+ */
+NativeProgram &NativeProgram::operator=(const NativeProgram &other)
+{
+	if (this != &other)
+	{
+		release();
+		_program = other._program;
+		assemble();
+	}
+	return *this;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🚀 running
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Runs a program without variables.
+ *
+ * @param result Receives the value of the expression on success.
+ * @return The status of the run, as Program::run returns it.
+ */
+Program::Status NativeProgram::run(int &result)
+{
+	return run(NULL, result);
+}
+
+/**
+ * Runs the program, natively when it was assembled, through Program::run otherwise.
+ *
+ * @param values The value of each variable, in the order of Program::variable(); may be NULL
+ * for a program without variables.
+ * @param result Receives the value of the expression on success.
+ * @return STATUS_OK, STATUS_DIVISION_BY_ZERO, STATUS_EMPTY for a program never compiled, or
+ * STATUS_UNBOUND_VARIABLE if values is NULL and the program reads variables.
+ */
+Program::Status NativeProgram::run(const int *values, int &result)
+{
+	if (!_function)
+		return _program.run(values, result);
+	if (!values && _program.variables() > 0)
+		return Program::STATUS_UNBOUND_VARIABLE;
+	return static_cast<Program::Status>(_function(values, &result));
+}
+
+/**
+ * @return true if run() executes machine code, false if it interprets the program.
+ */
+bool NativeProgram::native() const
+{
+	return _function != NULL;
+}
+
+/**
+ * @return The program the code was assembled from.
+ */
+const Program &NativeProgram::program() const
+{
+	return _program;
+}
+
+// ─────────────────────────────────────────────────────────────
+// 🔧 assembly
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Assembles the program into a fresh page, mapped writable to copy the code in, then switched
+ * to executable. Leaves the program interpreted if any step fails, or if the levels past the
+ * registers would take more than MAX_FRAME bytes of machine stack.
+ */
+void NativeProgram::assemble()
+{
+#if defined(__x86_64__)
+	if (_program.size() == 0 || _program.maxDepth() > REGISTERS + MAX_FRAME / 4)
+		return;
+
+	std::vector<uint8_t> code;
+	emitCode(_program, code);
+
+	size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t size = (code.size() + page - 1) / page * page;
+	void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		return;
+	std::memcpy(mapping, &code[0], code.size());
+	if (mprotect(mapping, size, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(mapping, size);
+		return;
+	}
+	_page = mapping;
+	_pageSize = size;
+	std::memcpy(&_function, &_page, sizeof(_function));
+#endif
+}
+
+/**
+ * Unmaps the code page, if any.
+ */
+void NativeProgram::release()
+{
+	if (_page)
+		munmap(_page, _pageSize);
+	_page = NULL;
+	_pageSize = 0;
+	_function = NULL;
+}
+
+/**
+ * Translates a program into the machine code of `int f(const int *values, int *result)`.
+ *
+ * Every stack level is known at assembly time, since the compiler validated the depth at each
+ * instruction: level d lives in g_registers[d], or at rsp + 4 * (d - REGISTERS) past the
+ * registers. Constants become immediates, variables loads from values (rdi). A division tests
+ * its divisor and jumps to a shared exit returning STATUS_DIVISION_BY_ZERO; a divisor of -1 is
+ * negated instead of divided, like Arithmetic::div, since idiv faults on INT_MIN / -1.
+ *
+ * @param program The compiled program, with at least one instruction.
+ * @param code Receives the machine code.
+ */
+void NativeProgram::emitCode(const Program &program, std::vector<uint8_t> &code)
+{
+	static const uint8_t ADD[] = { 0x03 };
+	static const uint8_t SUB[] = { 0x2B };
+	static const uint8_t IMUL[] = { 0x0F, 0xAF };
+	static const uint8_t MOV_IMM[] = { 0xC7 };
+	static const uint8_t DIVIDE[] = {
+		0x85, 0xC9,				// test ecx, ecx
+		0x0F, 0x84, 0, 0, 0, 0	// jz fail
+	};
+	static const uint8_t DIVIDE_NONZERO[] = {
+		0x83, 0xF9, 0xFF,		// cmp ecx, -1
+		0x75, 0x04,				// jne divide
+		0xF7, 0xD8,				// neg eax
+		0xEB, 0x03,				// jmp done
+		0x99,					// divide: cdq
+		0xF7, 0xF9				// idiv ecx
+	};
+
+	size_t used = std::min(program.maxDepth(), REGISTERS);
+	size_t spilled = program.maxDepth() - used;
+	uint32_t frame = static_cast<uint32_t>((spilled * 4 + 15) / 16 * 16);
+	std::vector<size_t> failures;
+
+	// Prologue: save the callee-saved registers in use, then make room for the deeper levels
+	for (size_t i = SCRATCH_REGISTERS; i < used; i++)
+	{
+		if (g_registers[i] >= 8)
+			code.push_back(0x41);
+		code.push_back(static_cast<uint8_t>(0x50 | (g_registers[i] & 7)));
+	}
+	if (frame)
+	{
+		static const uint8_t SUB_RSP[] = { 0x48, 0x81, 0xEC };
+		code.insert(code.end(), SUB_RSP, SUB_RSP + sizeof(SUB_RSP));
+		emitDword(code, frame);
+	}
+
+	size_t depth = 0;
+	for (size_t i = 0; i < program.size(); i++)
+	{
+		uint32_t word = program.instruction(i);
+		switch (word & 0xFF)
+		{
+			case Program::OP_PUSH:
+			{
+				uint32_t value = static_cast<uint32_t>(program.constant(word >> 8));
+				if (depth < REGISTERS)
+				{
+					// mov r32, imm32
+					if (g_registers[depth] >= 8)
+						code.push_back(0x41);
+					code.push_back(static_cast<uint8_t>(0xB8 | (g_registers[depth] & 7)));
+				}
+				else
+					emitLevel(code, MOV_IMM, sizeof(MOV_IMM), 0, depth);
+				emitDword(code, value);
+				depth++;
+				break;
+			}
+			case Program::OP_LOAD:
+			{
+				// mov r32, [rdi + 4 * index]
+				int reg = (depth < REGISTERS) ? g_registers[depth] : EAX;
+				if (reg >= 8)
+					code.push_back(0x44);
+				code.push_back(0x8B);
+				code.push_back(static_cast<uint8_t>(0x87 | (reg & 7) << 3));
+				emitDword(code, (word >> 8) * 4);
+				if (depth >= REGISTERS)
+					emitStore(code, EAX, depth);
+				depth++;
+				break;
+			}
+			case Program::OP_ADD:
+				emitArithmetic(code, ADD, sizeof(ADD), depth--);
+				break;
+			case Program::OP_SUB:
+				emitArithmetic(code, SUB, sizeof(SUB), depth--);
+				break;
+			case Program::OP_MUL:
+				emitArithmetic(code, IMUL, sizeof(IMUL), depth--);
+				break;
+			case Program::OP_DIV:
+				emitLoad(code, ECX, depth - 1);
+				code.insert(code.end(), DIVIDE, DIVIDE + sizeof(DIVIDE));
+				failures.push_back(code.size() - 4);
+				emitLoad(code, EAX, depth - 2);
+				code.insert(code.end(), DIVIDE_NONZERO, DIVIDE_NONZERO + sizeof(DIVIDE_NONZERO));
+				emitStore(code, EAX, depth - 2);
+				depth--;
+				break;
+		}
+	}
+
+	// mov [rsi], r32; xor eax, eax
+	if (g_registers[0] >= 8)
+		code.push_back(0x44);
+	code.push_back(0x89);
+	code.push_back(static_cast<uint8_t>(0x06 | (g_registers[0] & 7) << 3));
+	code.push_back(0x31);
+	code.push_back(0xC0);
+
+	// Epilogue, shared with the failure path
+	size_t exit = code.size();
+	if (frame)
+	{
+		static const uint8_t ADD_RSP[] = { 0x48, 0x81, 0xC4 };
+		code.insert(code.end(), ADD_RSP, ADD_RSP + sizeof(ADD_RSP));
+		emitDword(code, frame);
+	}
+	for (size_t i = used; i > SCRATCH_REGISTERS; i--)
+	{
+		if (g_registers[i - 1] >= 8)
+			code.push_back(0x41);
+		code.push_back(static_cast<uint8_t>(0x58 | (g_registers[i - 1] & 7)));
+	}
+	code.push_back(0xC3);
+
+	if (!failures.empty())
+	{
+		// fail: mov eax, STATUS_DIVISION_BY_ZERO; jmp exit
+		size_t fail = code.size();
+		code.push_back(0xB8);
+		emitDword(code, Program::STATUS_DIVISION_BY_ZERO);
+		code.push_back(0xE9);
+		emitDword(code, 0);
+		patchRel32(code, code.size() - 4, exit);
+		for (size_t i = 0; i < failures.size(); i++)
+			patchRel32(code, failures[i], fail);
+	}
+}
@@ -0,0 +1,379 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Program.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: meferraz <meferraz@student.42porto.pt>     +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/16 10:12:31 by meferraz          #+#    #+#             */
+/*   Updated: 2025/09/16 10:12:31 by meferraz         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Program.hpp"
+#include "../inc/Arithmetic.hpp"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Default constructor
+ *
+ * Initializes an empty program, which run() rejects.
+ */
+Program::Program() : _maxDepth(0) {}
+
+/**
+ * Copy constructor
+ *
+ * The scratch stacks are not copied; the copy allocates its own on first use.
+ *
+ * @param other The program to copy from.
+ */
+Program::Program(const Program &other)
+	: _code(other._code), _constants(other._constants), _variables(other._variables),
+	_maxDepth(other._maxDepth) {}
+
+/**
+ * Destructor
+ */
+Program::~Program() {}
+
+/**
+ * Assignment operator
+ *
+ * Like the copy constructor, it copies the instructions but not the scratch stacks.
+ *
+ * @param other The program to assign from.
+ * @return A reference to this program.
+ */
+Program &Program::operator=(const Program &other)
+{
+	if (this != &other)
+	{
+		_code = other._code;
+		_constants = other._constants;
+		_variables = other._variables;
+		std::vector<int>().swap(_stack);
+		std::vector<int>().swap(_blocks);
+		std::vector<const int *>().swap(_slots);
+		std::vector<int>().swap(_tail);
+		std::vector<const int *>().swap(_tailColumns);
+		_maxDepth = other._maxDepth;
+	}
+	return *this;
+}
+
+/**
+ * Appends an operator instruction.
+ *
+ * @param op The opcode, other than OP_PUSH.
+ */
+void Program::emit(Opcode op)
+{
+	_code.push_back(static_cast<uint32_t>(op));
+}
+
+/**
+ * Appends an instruction pushing a constant, adding it to the constant pool.
+ *
+ * @param value The constant.
+ */
+void Program::emitPush(int value)
+{
+	_code.push_back(static_cast<uint32_t>(OP_PUSH) | static_cast<uint32_t>(_constants.size()) << 8);
+	_constants.push_back(value);
+}
+
+/**
+ * Appends an instruction pushing the value of a variable. Variables are numbered in the order
+ * they first appear.
+ *
+ * @param name The name of the variable.
+ */
+void Program::emitLoad(const std::string &name)
+{
+	size_t index = 0;
+	while (index < _variables.size() && _variables[index] != name)
+		index++;
+	if (index == _variables.size())
+		_variables.push_back(name);
+	_code.push_back(static_cast<uint32_t>(OP_LOAD) | static_cast<uint32_t>(index) << 8);
+}
+
+/**
+ * Completes the program once every instruction was emitted.
+ *
+ * Only the depth is recorded: the scratch stacks of run() and runColumns() are allocated by
+ * their first call, so a program that is never run over columns does not pay for the blocks.
+ *
+ * @param maxDepth The largest stack depth reached by the instructions, as computed by the
+ * compiler.
+ */
+void Program::finish(size_t maxDepth)
+{
+	_maxDepth = maxDepth;
+}
+
+/**
+ * Runs a program without variables.
+ *
+ * @param result Receives the value of the expression on success.
+ * @return The status of the run (see the other overload), STATUS_UNBOUND_VARIABLE if the program
+ * reads variables.
+ */
+Program::Status Program::run(int &result)
+{
+	return run(NULL, result);
+}
+
+/**
+ * Runs the program.
+ *
+ * The instructions were validated at compile time, so the loop neither checks the stack bounds
+ * nor handles strings; a division by zero stops it with a status instead of an exception.
+ *
+ * @param values The value of each variable, in the order of variable(); may be NULL for a
+ * program without variables.
+ * @param result Receives the value of the expression on success.
+ * @return STATUS_OK, STATUS_DIVISION_BY_ZERO, STATUS_EMPTY for a program never compiled, or
+ * STATUS_UNBOUND_VARIABLE if values is NULL and the program reads variables.
+ */
+Program::Status Program::run(const int *values, int &result)
+{
+	if (_code.empty() || _maxDepth == 0)
+		return STATUS_EMPTY;
+	if (!values && !_variables.empty())
+		return STATUS_UNBOUND_VARIABLE;
+	if (_stack.empty())
+		_stack.assign(_maxDepth, 0);
+
+	const int *constants = _constants.empty() ? NULL : &_constants[0];
+	const uint32_t *ip = &_code[0];
+	const uint32_t *end = ip + _code.size();
+	int *sp = &_stack[0];
+	for (; ip != end; ++ip)
+	{
+		uint32_t word = *ip;
+		switch (word & 0xFF)
+		{
+			case OP_PUSH:
+				*sp++ = constants[word >> 8];
+				break;
+			case OP_LOAD:
+				*sp++ = values[word >> 8];
+				break;
+			case OP_ADD:
+				sp[-2] = Arithmetic::add(sp[-2], sp[-1]);
+				--sp;
+				break;
+			case OP_SUB:
+				sp[-2] = Arithmetic::sub(sp[-2], sp[-1]);
+				--sp;
+				break;
+			case OP_MUL:
+				sp[-2] = Arithmetic::mul(sp[-2], sp[-1]);
+				--sp;
+				break;
+			case OP_DIV:
+				if (sp[-1] == 0)
+					return STATUS_DIVISION_BY_ZERO;
+				sp[-2] = Arithmetic::div(sp[-2], sp[-1]);
+				--sp;
+				break;
+		}
+	}
+	result = sp[-1];
+	return STATUS_OK;
+}
+
+/**
+ * Column kernels: each applies one operator to a block of BATCH_ROWS rows. They are plain loops
+ * of a fixed length over flat arrays that never overlap, so the compiler can vectorize them
+ * without alias checks or remainder loops.
+ */
+static void addColumns(const int *__restrict__ a, const int *__restrict__ b, int *__restrict__ out)
+{
+	for (size_t i = 0; i < Program::BATCH_ROWS; i++)
+		out[i] = Arithmetic::add(a[i], b[i]);
+}
+
+static void subColumns(const int *__restrict__ a, const int *__restrict__ b, int *__restrict__ out)
+{
+	for (size_t i = 0; i < Program::BATCH_ROWS; i++)
+		out[i] = Arithmetic::sub(a[i], b[i]);
+}
+
+static void mulColumns(const int *__restrict__ a, const int *__restrict__ b, int *__restrict__ out)
+{
+	for (size_t i = 0; i < Program::BATCH_ROWS; i++)
+		out[i] = Arithmetic::mul(a[i], b[i]);
+}
+
+/**
+ * Divides a block of rows without branching on the divisors: a zero divisor marks its row and
+ * is replaced by 1.
+ */
+static void divColumns(const int *__restrict__ a, const int *__restrict__ b, int *__restrict__ out,
+	uint8_t *__restrict__ status)
+{
+	for (size_t i = 0; i < Program::BATCH_ROWS; i++)
+	{
+		int zero = (b[i] == 0);
+		status[i] |= static_cast<uint8_t>(zero * Program::STATUS_DIVISION_BY_ZERO);
+		out[i] = Arithmetic::div(a[i], b[i] + zero);
+	}
+}
+
+/**
+ * Runs the program over columns of rows, one value per variable and row.
+ *
+ * Rows are evaluated BATCH_ROWS at a time. Each stack entry is a block of BATCH_ROWS values: a
+ * constant is broadcast to a block, a variable refers to its column directly, and an operator
+ * runs one column kernel over its two operand blocks. Each depth owns two blocks, and an
+ * operator writes to the one its left operand is not in, so kernels never write over their
+ * inputs. The last block, when partial, is copied and padded first, so every kernel runs over a
+ * full block. Rows that divide by zero do not stop the others; they get a status and a result
+ * of 0.
+ *
+ * @param columns One column of rows per variable, in the order of variable(); may be NULL for
+ * a program without variables.
+ * @param rows The number of rows.
+ * @param results Receives the value of each row.
+ * @param status Receives the Program::Status of each row.
+ * @return The number of rows that failed.
+ */
+size_t Program::runColumns(const int *const *columns, size_t rows, int *results, uint8_t *status)
+{
+	if (_code.empty() || _maxDepth == 0 || (!columns && !_variables.empty()))
+	{
+		std::memset(results, 0, rows * sizeof(int));
+		std::memset(status, (_code.empty() || _maxDepth == 0) ? STATUS_EMPTY : STATUS_UNBOUND_VARIABLE, rows);
+		return rows;
+	}
+	if (_blocks.empty())
+	{
+		_blocks.assign(2 * _maxDepth * BATCH_ROWS, 0);
+		_slots.assign(_maxDepth, static_cast<const int *>(NULL));
+		_tail.assign(_variables.size() * BATCH_ROWS, 0);
+		_tailColumns.assign(_variables.size(), static_cast<const int *>(NULL));
+	}
+
+	uint8_t state[BATCH_ROWS];
+	size_t failed = 0;
+	for (size_t start = 0; start < rows; start += BATCH_ROWS)
+	{
+		size_t n = (rows - start < BATCH_ROWS) ? rows - start : BATCH_ROWS;
+		const int *const *source = columns;
+		size_t offset = start;
+		if (n < BATCH_ROWS)
+		{
+			for (size_t v = 0; v < _variables.size(); v++)
+			{
+				int *padded = &_tail[v * BATCH_ROWS];
+				std::memcpy(padded, columns[v] + start, n * sizeof(int));
+				std::fill(padded + n, padded + BATCH_ROWS, 1);
+				_tailColumns[v] = padded;
+			}
+			source = _tailColumns.empty() ? NULL : &_tailColumns[0];
+			offset = 0;
+		}
+		std::memset(state, STATUS_OK, BATCH_ROWS);
+
+		size_t depth = 0;
+		for (size_t i = 0; i < _code.size(); i++)
+		{
+			uint32_t word = _code[i];
+			if ((word & 0xFF) == OP_LOAD)
+			{
+				_slots[depth++] = source[word >> 8] + offset;
+				continue;
+			}
+			size_t level = depth - ((word & 0xFF) == OP_PUSH ? 0 : 2);
+			int *out = &_blocks[2 * level * BATCH_ROWS];
+			if (out == _slots[level])
+				out += BATCH_ROWS;
+			switch (word & 0xFF)
+			{
+				case OP_PUSH:
+					std::fill(out, out + BATCH_ROWS, _constants[word >> 8]);
+					_slots[depth++] = out;
+					continue;
+				case OP_ADD:
+					addColumns(_slots[depth - 2], _slots[depth - 1], out);
+					break;
+				case OP_SUB:
+					subColumns(_slots[depth - 2], _slots[depth - 1], out);
+					break;
+				case OP_MUL:
+					mulColumns(_slots[depth - 2], _slots[depth - 1], out);
+					break;
+				case OP_DIV:
+					divColumns(_slots[depth - 2], _slots[depth - 1], out, state);
+					break;
+			}
+			_slots[depth - 2] = out;
+			depth--;
+		}
+
+		const int *value = _slots[0];
+		int *result = results + start;
+		for (size_t i = 0; i < n; i++)
+		{
+			result[i] = state[i] ? 0 : value[i];
+			status[start + i] = state[i];
+			failed += (state[i] != STATUS_OK);
+		}
+	}
+	return failed;
+}
+
+/**
+ * @return The number of instructions.
+ */
+size_t Program::size() const
+{
+	return _code.size();
+}
+
+/**
+ * @param index An instruction number, below size().
+ * @return The instruction: its opcode in the low byte, its operand index above.
+ */
+uint32_t Program::instruction(size_t index) const
+{
+	return _code[index];
+}
+
+/**
+ * @param index A constant number, as found in an OP_PUSH instruction.
+ * @return The constant.
+ */
+int Program::constant(size_t index) const
+{
+	return _constants[index];
+}
+
+/**
+ * @return The largest stack depth reached while running the program.
+ */
+size_t Program::maxDepth() const
+{
+	return _maxDepth;
+}
+
+/**
+ * @return The number of variables read by the program.
+ */
+size_t Program::variables() const
+{
+	return _variables.size();
+}
+
+/**
+ * @param index A variable number, below variables().
+ * @return The name of the variable.
+ */
+const std::string &Program::variable(size_t index) const
+{
+	return _variables[index];
+}
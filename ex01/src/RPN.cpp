@@ -12,6 +12,13 @@
 
 #include "../inc/RPN.hpp"
 #include "../inc/ansi.h"
+#include "../inc/Arithmetic.hpp"
+#include "../inc/LineReader.hpp"
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
 
 /**
  * Default constructor
@@ -171,3 +178,558 @@ void RPN::processToken(const std::string &token)
 		throw std::runtime_error("Invalid token: '" + token + "'");
 	}
 }
+
+/**
+ * Recognizes the whitespace that separates tokens, as std::isspace does in the "C" locale.
+ */
+static inline bool isBlank(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Evaluates a Reverse Polish Notation expression without allocating.
+ *
+ * The operands live in an array of STACK_CAPACITY ints on the call stack instead of a
+ * std::stack, tokens are scanned in place, numbers are parsed by hand (see parseNumber), and
+ * errors are returned as a status instead of being thrown, so an expression costs no heap
+ * allocation whether it is valid or not.
+ *
+ * Tokens are accepted like the other overload and errors are found in the same order; unlike
+ * it, arithmetic wraps around on overflow, like Program::run.
+ *
+ * @param begin The first character of the expression.
+ * @param end One past its last character.
+ * @param result Receives the value of the expression on success.
+ * @param where If not NULL, receives the start of the token that failed, or end when the
+ * expression as a whole is invalid.
+ * @return STATUS_OK, or the reason the expression failed (see message()). STATUS_STACK_OVERFLOW
+ * reports an expression needing more than STACK_CAPACITY operands at once.
+ */
+RPN::Status RPN::evaluate(const char *begin, const char *end, int &result, const char **where)
+{
+	int stack[STACK_CAPACITY];
+	int *sp = stack;
+	const char *p = begin;
+	Status status = STATUS_OK;
+
+	while (true)
+	{
+		while (p < end && isBlank(*p))
+			p++;
+		if (p == end)
+			break;
+		const char *token = p;
+		while (p < end && !isBlank(*p))
+			p++;
+
+		Program::Opcode op;
+		int value;
+		if (isOperator(token, p, op))
+		{
+			if (sp - stack < 2)
+				status = STATUS_NOT_ENOUGH_OPERANDS;
+			else if (op == Program::OP_DIV && sp[-1] == 0)
+				status = STATUS_DIVISION_BY_ZERO;
+			else
+			{
+				int a = sp[-2];
+				int b = sp[-1];
+				switch (op)
+				{
+					case Program::OP_ADD: sp[-2] = Arithmetic::add(a, b); break;
+					case Program::OP_SUB: sp[-2] = Arithmetic::sub(a, b); break;
+					case Program::OP_MUL: sp[-2] = Arithmetic::mul(a, b); break;
+					default: sp[-2] = Arithmetic::div(a, b); break;
+				}
+				--sp;
+				continue;
+			}
+		}
+		else if (parseNumber(token, p, value))
+		{
+			if (sp == stack + STACK_CAPACITY)
+				status = STATUS_STACK_OVERFLOW;
+			else
+			{
+				*sp++ = value;
+				continue;
+			}
+		}
+		else
+			status = STATUS_INVALID_TOKEN;
+
+		if (where)
+			*where = token;
+		return status;
+	}
+
+	if (sp - stack != 1)
+	{
+		if (where)
+			*where = end;
+		return STATUS_INVALID_EXPRESSION;
+	}
+	result = stack[0];
+	return STATUS_OK;
+}
+
+/**
+ * @param status A status returned by evaluate.
+ * @return The error message the throwing overload uses for the same failure, without the
+ * token.
+ */
+const char *RPN::message(Status status)
+{
+	switch (status)
+	{
+		case STATUS_OK: return "OK";
+		case STATUS_NOT_ENOUGH_OPERANDS: return "Not enough operands";
+		case STATUS_INVALID_TOKEN: return "Invalid token";
+		case STATUS_INVALID_EXPRESSION: return "Invalid RPN expression";
+		case STATUS_DIVISION_BY_ZERO: return "Division by zero";
+		case STATUS_STACK_OVERFLOW: return "Expression too deep";
+	}
+	return "Unknown error";
+}
+
+/**
+ * Appends an int in decimal.
+ */
+static void appendInt(OutputBuffer &out, int value)
+{
+	char digits[12];
+	char *p = digits + sizeof(digits);
+	unsigned int magnitude = (value < 0) ? 0u - static_cast<unsigned int>(value) : static_cast<unsigned int>(value);
+	do
+	{
+		*--p = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0)
+		*--p = '-';
+	out.append(p, static_cast<size_t>(digits + sizeof(digits) - p));
+}
+
+/**
+ * Evaluates newline-separated expressions and writes one line per expression: its value, or
+ * "Error: " followed by the message evaluate would throw. Lines are evaluated with the
+ * allocation-free overload, so arithmetic wraps around on overflow.
+ *
+ * @param begin The first character of the lines.
+ * @param end One past the last character; a last line without a newline is evaluated too.
+ * @param out The buffer receiving the output.
+ * @return The number of expressions that failed.
+ */
+size_t RPN::evaluateLines(const char *begin, const char *end, OutputBuffer &out)
+{
+	size_t failed = 0;
+	const char *p = begin;
+	while (p < end)
+	{
+		const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+		const char *lineEnd = eol ? eol : end;
+		int result;
+		const char *where;
+		Status status = evaluate(p, lineEnd, result, &where);
+		if (status == STATUS_OK)
+			appendInt(out, result);
+		else
+		{
+			failed++;
+			out.append("Error: ");
+			out.append(message(status));
+			if (status == STATUS_INVALID_TOKEN)
+			{
+				const char *tokenEnd = where;
+				while (tokenEnd < lineEnd && !isBlank(*tokenEnd))
+					tokenEnd++;
+				out.append(": '");
+				out.append(where, static_cast<size_t>(tokenEnd - where));
+				out.append('\'');
+			}
+		}
+		out.append('\n');
+		p = eol ? eol + 1 : end;
+	}
+	return failed;
+}
+
+/**
+ * Evaluates every line read from a file descriptor, as evaluateLines does.
+ *
+ * Input is read in large blocks of whole lines (see LineReader) and results are collected in
+ * the block-buffered writer, so millions of expressions cost a few hundred system calls.
+ *
+ * With more than one thread, blocks are evaluated in parallel and their results are still
+ * written in input order.
+ *
+ * @param fd The file descriptor to read expressions from. It is not closed.
+ * @param out The buffer receiving the output.
+ * @param threads The number of threads to use; 0 or 1 evaluates on the calling thread.
+ * @return The number of expressions that failed.
+ * @throw std::runtime_error if the input cannot be read or the output written.
+ */
+size_t RPN::evaluateStream(int fd, OutputBuffer &out, size_t threads)
+{
+	if (threads > 1)
+		return evaluateParallel(fd, out, threads);
+
+	LineReader reader(fd);
+	const char *begin;
+	const char *end;
+	size_t failed = 0;
+	while (reader.nextBlock(begin, end))
+		failed += evaluateLines(begin, end, out);
+	out.flush();
+	return failed;
+}
+
+/**
+ * Shared state of a multi-threaded stream evaluation.
+ *
+ * The calling thread reads blocks of lines and copies each into one of `window` slots, used as
+ * a ring indexed by block number. Workers claim blocks in order and format each one into the
+ * output of its slot; the calling thread writes finished blocks in their original order, and
+ * only refills a slot once its output was written, which bounds the memory held by pending
+ * blocks.
+ */
+struct StreamJob
+{
+	std::vector<std::vector<char> > inputs;
+	std::vector<std::vector<char> > outputs;
+	std::vector<size_t> failures;
+	std::vector<char> done;
+	size_t window;
+	size_t read;
+	size_t next;
+	bool finished;
+	bool failed;
+	pthread_mutex_t mutex;
+	pthread_cond_t ready;
+	pthread_cond_t work;
+};
+
+/**
+ * Worker thread body: claims blocks, evaluates them and marks them as done.
+ *
+ * @param arg The StreamJob shared by all workers.
+ * @return Always NULL.
+ */
+void *RPN::evaluateChunks(void *arg)
+{
+	StreamJob *job = static_cast<StreamJob *>(arg);
+
+	for (;;)
+	{
+		pthread_mutex_lock(&job->mutex);
+		while (!job->failed && !job->finished && job->next == job->read)
+			pthread_cond_wait(&job->work, &job->mutex);
+		if (job->failed || job->next == job->read)
+		{
+			pthread_mutex_unlock(&job->mutex);
+			break;
+		}
+		size_t slot = job->next++ % job->window;
+		pthread_mutex_unlock(&job->mutex);
+
+		bool ok = true;
+		try {
+			const std::vector<char> &input = job->inputs[slot];
+			OutputBuffer out(job->outputs[slot]);
+			job->failures[slot] = evaluateLines(&input[0], &input[0] + input.size(), out);
+			out.flush();
+		} catch (const std::exception &) {
+			ok = false;
+		}
+
+		pthread_mutex_lock(&job->mutex);
+		if (ok)
+			job->done[slot] = 1;
+		else
+			job->failed = true;
+		pthread_cond_broadcast(&job->ready);
+		pthread_cond_broadcast(&job->work);
+		pthread_mutex_unlock(&job->mutex);
+		if (!ok)
+			break;
+	}
+	return NULL;
+}
+
+/**
+ * Evaluates a stream with several threads, keeping the output in input order.
+ *
+ * @param fd The file descriptor to read expressions from.
+ * @param out The buffer receiving the output.
+ * @param threads The number of worker threads to start.
+ * @return The number of expressions that failed.
+ * @throw std::runtime_error if the input cannot be read, the output written, or a worker fails.
+ */
+size_t RPN::evaluateParallel(int fd, OutputBuffer &out, size_t threads)
+{
+	StreamJob job;
+	job.window = threads * 4;
+	job.inputs.resize(job.window);
+	job.outputs.resize(job.window);
+	job.failures.assign(job.window, 0);
+	job.done.assign(job.window, 0);
+	job.read = 0;
+	job.next = 0;
+	job.finished = false;
+	job.failed = false;
+	pthread_mutex_init(&job.mutex, NULL);
+	pthread_cond_init(&job.ready, NULL);
+	pthread_cond_init(&job.work, NULL);
+
+	std::vector<pthread_t> workers;
+	for (size_t t = 0; t < threads; t++)
+	{
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, &RPN::evaluateChunks, &job) == 0)
+			workers.push_back(tid);
+	}
+
+	if (workers.empty())
+	{
+		pthread_cond_destroy(&job.work);
+		pthread_cond_destroy(&job.ready);
+		pthread_mutex_destroy(&job.mutex);
+		return evaluateStream(fd, out, 1);
+	}
+
+	LineReader reader(fd);
+	size_t failed = 0;
+	size_t written = 0;
+	bool broken = false;
+	try {
+		bool eof = false;
+		while (!eof || written < job.read)
+		{
+			const char *begin;
+			const char *end;
+			while (!eof && job.read - written < job.window)
+			{
+				eof = !reader.nextBlock(begin, end);
+				pthread_mutex_lock(&job.mutex);
+				if (eof)
+					job.finished = true;
+				else
+				{
+					size_t slot = job.read % job.window;
+					job.inputs[slot].assign(begin, end);
+					job.read++;
+				}
+				pthread_cond_broadcast(&job.work);
+				pthread_mutex_unlock(&job.mutex);
+			}
+			if (written == job.read)
+				continue;
+
+			size_t slot = written % job.window;
+			pthread_mutex_lock(&job.mutex);
+			while (!job.done[slot] && !job.failed)
+				pthread_cond_wait(&job.ready, &job.mutex);
+			broken = job.failed;
+			pthread_mutex_unlock(&job.mutex);
+			if (broken)
+				break;
+
+			if (!job.outputs[slot].empty())
+				out.append(&job.outputs[slot][0], job.outputs[slot].size());
+			failed += job.failures[slot];
+			job.outputs[slot].clear();
+			job.done[slot] = 0;
+			written++;
+		}
+		out.flush();
+	} catch (const std::exception &) {
+		broken = true;
+	}
+
+	pthread_mutex_lock(&job.mutex);
+	job.finished = true;
+	if (broken)
+		job.failed = true;
+	pthread_cond_broadcast(&job.work);
+	pthread_mutex_unlock(&job.mutex);
+	for (size_t t = 0; t < workers.size(); t++)
+		pthread_join(workers[t], NULL);
+	pthread_cond_destroy(&job.work);
+	pthread_cond_destroy(&job.ready);
+	pthread_mutex_destroy(&job.mutex);
+
+	if (broken)
+		throw std::runtime_error("could not evaluate input in parallel.");
+	return failed;
+}
+
+/**
+ * Compiles a Reverse Polish Notation expression into a program.
+ *
+ * Tokens are scanned in place and checked once: operators become opcodes, numbers become
+ * constants, and the stack depth is tracked through the expression so that the program never
+ * underflows or outgrows its stack when run. The program can then be run any number of times
+ * without touching the text again (see Program::run).
+ *
+ * Tokens are accepted like evaluate does, plus variables: names made of letters, digits and
+ * underscores, not starting with a digit, whose values are given when the program is run (see
+ * Program::run and Program::runColumns). Every token is checked before anything is computed, so
+ * an invalid token is reported even after a division by zero.
+ *
+ * @param expression The RPN expression to compile.
+ * @return The compiled program.
+ * @throw std::runtime_error if the expression is invalid.
+ */
+Program RPN::compile(const std::string &expression)
+{
+	Program program;
+	size_t depth = 0;
+	size_t maxDepth = 0;
+	const char *p = expression.c_str();
+	const char *end = p + expression.size();
+
+	while (p < end)
+	{
+		while (p < end && std::isspace(static_cast<unsigned char>(*p)))
+			p++;
+		const char *token = p;
+		while (p < end && !std::isspace(static_cast<unsigned char>(*p)))
+			p++;
+		if (token == p)
+			break;
+
+		Program::Opcode op;
+		int value;
+		if (isOperator(token, p, op))
+		{
+			if (depth < 2)
+			{
+				throw std::runtime_error("Not enough operands");
+			}
+			program.emit(op);
+			depth--;
+		}
+		else if (parseNumber(token, p, value))
+		{
+			if (program.size() >= Program::MAX_CONSTANTS)
+			{
+				throw std::runtime_error("Expression too long");
+			}
+			program.emitPush(value);
+			if (++depth > maxDepth)
+				maxDepth = depth;
+		}
+		else if (isName(token, p))
+		{
+			if (program.size() >= Program::MAX_CONSTANTS)
+			{
+				throw std::runtime_error("Expression too long");
+			}
+			program.emitLoad(std::string(token, p));
+			if (++depth > maxDepth)
+				maxDepth = depth;
+		}
+		else
+		{
+			throw std::runtime_error("Invalid token: '" + std::string(token, p) + "'");
+		}
+	}
+
+	if (depth != 1)
+	{
+		throw std::runtime_error("Invalid RPN expression");
+	}
+	program.finish(maxDepth);
+	return program;
+}
+
+/**
+ * Compiles a Reverse Polish Notation expression into native code.
+ *
+ * The expression is compiled and validated like compile does, then translated to x86-64 machine
+ * code (see NativeProgram). Where that is not possible, the returned program interprets the
+ * compiled form instead, with the same results.
+ *
+ * @param expression The RPN expression to compile.
+ * @return The callable program.
+ * @throw std::runtime_error if the expression is invalid.
+ */
+NativeProgram RPN::compileNative(const std::string &expression)
+{
+	return NativeProgram(compile(expression));
+}
+
+/**
+ * Recognizes an operator token.
+ *
+ * @param begin The first character of the token.
+ * @param end One past its last character.
+ * @param op Receives the opcode of the operator.
+ * @return true if the token is one of "+", "-", "*" and "/".
+ */
+bool RPN::isOperator(const char *begin, const char *end, Program::Opcode &op)
+{
+	if (end - begin != 1)
+		return false;
+	switch (*begin)
+	{
+		case '+': op = Program::OP_ADD; return true;
+		case '-': op = Program::OP_SUB; return true;
+		case '*': op = Program::OP_MUL; return true;
+		case '/': op = Program::OP_DIV; return true;
+		default: return false;
+	}
+}
+
+/**
+ * Parses a number token: digits, optionally preceded by a minus sign.
+ *
+ * Values beyond the range of an int are clamped to it, as the stream extraction used by
+ * evaluate does.
+ *
+ * @param begin The first character of the token.
+ * @param end One past its last character.
+ * @param value Receives the number.
+ * @return true if the token is a number.
+ */
+bool RPN::parseNumber(const char *begin, const char *end, int &value)
+{
+	bool negative = (begin < end && *begin == '-');
+	const char *p = begin + negative;
+	if (p == end)
+		return false;
+
+	long long magnitude = 0;
+	for (; p < end; p++)
+	{
+		if (*p < '0' || *p > '9')
+			return false;
+		if (magnitude <= INT_MAX)
+			magnitude = magnitude * 10 + (*p - '0');
+	}
+	if (negative)
+		value = (-magnitude < INT_MIN) ? INT_MIN : static_cast<int>(-magnitude);
+	else
+		value = (magnitude > INT_MAX) ? INT_MAX : static_cast<int>(magnitude);
+	return true;
+}
+
+/**
+ * Recognizes a variable name: letters, digits and underscores, not starting with a digit.
+ *
+ * @param begin The first character of the token.
+ * @param end One past its last character.
+ * @return true if the token is a variable name.
+ */
+bool RPN::isName(const char *begin, const char *end)
+{
+	if (begin == end || std::isdigit(static_cast<unsigned char>(*begin)))
+		return false;
+	for (const char *p = begin; p < end; p++)
+	{
+		if (!std::isalnum(static_cast<unsigned char>(*p)) && *p != '_')
+			return false;
+	}
+	return true;
+}
@@ -11,6 +11,10 @@
 /* ************************************************************************** */
 
 #include <iostream>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
 #include "../inc/ansi.h"
 #include "../inc/RPN.hpp"
 
@@ -20,18 +24,89 @@
 								<< "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" RESET "\n" \
 								<< std::endl;
 
+// ─────────────────────────────────────────────────────────────
+// 🌊 streaming
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * Evaluates one expression per line of a file, or of stdin for "-", and prints one result or
+ * error per line. Nothing else is printed on stdout, so the output can be piped.
+ *
+ * @return 0 if every expression was valid, 1 otherwise.
+ */
+static int streamExpressions(const char *input, size_t threads)
+{
+	bool errorColors = isatty(STDERR_FILENO);
+	int fd = STDIN_FILENO;
+	if (std::string(input) != "-")
+	{
+		fd = open(input, O_RDONLY);
+		if (fd < 0)
+		{
+			std::cerr << (errorColors ? BRED : "") << "❌ Error: could not open file."
+					  << (errorColors ? RESET : "") << std::endl;
+			return 1;
+		}
+	}
+
+	size_t failed = 0;
+	bool ok = true;
+	try {
+		OutputBuffer out(STDOUT_FILENO);
+		failed = RPN::evaluateStream(fd, out, threads);
+	} catch (const std::exception& e) {
+		std::cerr << (errorColors ? BRED : "") << "❌ Error: " << e.what() << (errorColors ? RESET : "") << std::endl;
+		ok = false;
+	}
+	if (fd != STDIN_FILENO)
+		close(fd);
+	return (ok && failed == 0) ? 0 : 1;
+}
+
 // ─────────────────────────────────────────────────────────────
 // 🚀 main()
 // ─────────────────────────────────────────────────────────────
 
 int main(int argc, char **argv)
 {
-	std::cout << BGRN "\n\n📋===== RPN CALCULATOR SIMULATION =====📋\n\n" RESET;
+	const char *input = NULL;
+	const char *expression = NULL;
+	long threads = 1;
+	bool valid = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--stream" && i + 1 < argc)
+			input = argv[++i];
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			char *endptr;
+			threads = std::strtol(argv[++i], &endptr, 10);
+			if (*endptr != '\0' || threads < 1 || threads > 1024)
+				valid = false;
+		}
+		else if (!expression)
+			expression = argv[i];
+		else
+			valid = false;
+	}
+	valid = valid && (input != NULL) != (expression != NULL) && (input || threads == 1);
+
+	// Streamed results on stdout must not be preceded by the banner
+	if (valid && input)
+		return streamExpressions(input, static_cast<size_t>(threads));
+
+	// Each stream is colored only if it is a terminal
+	bool colors = isatty(STDOUT_FILENO);
+	bool errorColors = isatty(STDERR_FILENO);
+	std::cout << (colors ? BGRN : "") << "\n\n📋===== RPN CALCULATOR SIMULATION =====📋\n\n" << (colors ? RESET : "");
 
-	if (argc != 2)
+	if (!valid)
 	{
-		std::cout << BRED "❌ Error: Invalid number of arguments." RESET
-				  << " Usage: ./rpn \"<expression>\"" << std::endl;
+		std::cerr << (errorColors ? BRED : "") << "❌ Error: Invalid number of arguments."
+				  << (errorColors ? RESET : "") << " Usage: ./rpn \"<expression>\"\n"
+				  << "       ./rpn [--threads N] --stream <file | ->" << std::endl;
 		return 1;
 	}
 
@@ -39,10 +114,11 @@ int main(int argc, char **argv)
 	int result;
 
 	try {
-		result = rpn.evaluate(argv[1]);
-		std::cout << BGRN "✅ Result: " BCYN << result << RESET << std::endl;
+		result = rpn.evaluate(expression);
+		std::cout << (colors ? BGRN : "") << "✅ Result: " << (colors ? BCYN : "") << result
+				  << (colors ? RESET : "") << std::endl;
 	} catch (const std::exception& e) {
-		std::cerr << BRED "❌ Error: " << e.what() << RESET << std::endl;
+		std::cerr << (errorColors ? BRED : "") << "❌ Error: " << e.what() << (errorColors ? RESET : "") << std::endl;
 		return 1;
 	}
 